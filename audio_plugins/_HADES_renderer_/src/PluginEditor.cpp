@@ -863,21 +863,11 @@ void PluginEditor::paint (juce::Graphics& g)
     switch (currentWarning){
         case k_warning_none:
             break;
-        case k_warning_frameSize:
-            g.drawText(TRANS("Set frame size to multiple of ") + String(hades_renderer_getFrameSize()),
-                       getBounds().getWidth()-225, 16, 530, 11,
-                       Justification::centredLeft, true);
-            break;
         case k_warning_supported_fs:
             g.drawText(TRANS("Sample rate (") + String(hades_renderer_getDAWsamplerate(hHdR)) + TRANS(") is unsupported"),
                        getBounds().getWidth()-225, 16, 530, 11,
                        Justification::centredLeft, true);
             break;
-        case k_warning_mismatch_fs:
-            g.drawText(TRANS("Sample rate mismatch between DAW/IRs/HRIRs"),
-                       getBounds().getWidth()-225, 16, 530, 11,
-                       Justification::centredLeft, true);
-            break;
         case k_warning_NinputCH:
             g.drawText(TRANS("Insufficient number of input channels (") + String(hVst->getTotalNumInputChannels()) +
                        TRANS("/") + String(hades_renderer_getNmicsArray(hHdR)) + TRANS(")"),
@@ -1012,20 +1002,12 @@ void PluginEditor::timerCallback(int timerID)
                     fileChooserHRIR.setEnabled(true);
             }
 
-            /* display warning message, if needed */
-            if ((hVst->getCurrentBlockSize() % hades_renderer_getFrameSize()) != 0){
-                currentWarning = k_warning_frameSize;
-                repaint(0,0,getWidth(),32);
-            }
-            else if ( !((hades_renderer_getDAWsamplerate(hHdR) == 44.1e3) || (hades_renderer_getDAWsamplerate(hHdR) == 48e3)) ){
+            /* display warning message, if needed (IRs/HRIRs at other sample rates are converted to the DAW's) */
+            if ( !((hades_renderer_getDAWsamplerate(hHdR) == 44.1e3) || (hades_renderer_getDAWsamplerate(hHdR) == 48e3) ||
+                   (hades_renderer_getDAWsamplerate(hHdR) == 88.2e3) || (hades_renderer_getDAWsamplerate(hHdR) == 96e3)) ){
                 currentWarning = k_warning_supported_fs;
                 repaint(0,0,getWidth(),32);
             }
-            else if ((hades_renderer_getDAWsamplerate(hHdR) != hades_renderer_getIRsamplerateArray(hHdR)) ||
-                      hades_renderer_getDAWsamplerate(hHdR) != hades_renderer_getIRsamplerateBin(hHdR)){
-                currentWarning = k_warning_mismatch_fs;
-                repaint(0,0,getWidth(),32);
-            }
             else if (hVst->getCurrentNumInputs() < hades_renderer_getNmicsArray(hHdR)){
                 currentWarning = k_warning_NinputCH;
                 repaint(0,0,getWidth(),32);
@@ -25,9 +25,7 @@
 
 typedef enum _HADES_WARNINGS{
     k_warning_none,
-    k_warning_frameSize,
     k_warning_supported_fs,
-    k_warning_mismatch_fs,
     k_warning_NinputCH,
     k_warning_NoutputCH
 }HADES_WARNINGS;
@@ -26,6 +26,16 @@ AudioProcessor(BusesProperties()
 	nSampleRate = 48000;
 	hades_renderer_create(&hHdR);
 
+    /* Shared by all instances, so that the SOFA files loaded by one are cached for the others (the least recently used
+     * entries are removed once it exceeds the limit) */
+    File cacheDir = File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("HADES").getChildFile("cache");
+    if(cacheDir.createDirectory().wasOk()){
+        hades_renderer_setCacheDirectory(hHdR, cacheDir.getFullPathName().toRawUTF8());
+        hades_renderer_setCacheSizeLimit(hHdR, 512);
+    }
+
+    /* Settings changes are picked up straight away by a background thread (the timer only reports the latency) */
+    hades_renderer_startInitService(hHdR);
     startTimer(TIMER_PROCESSING_RELATED, 40); 
 }
 
@@ -88,7 +98,8 @@ const String PluginProcessor::getOutputChannelName (int channelIndex) const
 
 double PluginProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    /* (the filterbanks keep ringing out after the input has gone silent) */
+    return nSampleRate > 0 ? (double)hades_renderer_getProcessingDelay(hHdR)/(double)nSampleRate : 0.0;
 }
 
 int PluginProcessor::getNumPrograms()
@@ -141,7 +152,7 @@ bool PluginProcessor::producesMidi() const
 
 bool PluginProcessor::silenceInProducesSilenceOut() const
 {
-    return false;
+    return hades_renderer_getEnableSilenceGate(hHdR) != 0;
 }
 
 void PluginProcessor::changeProgramName (int /*index*/, const String& /*newName*/)
@@ -168,21 +179,13 @@ void PluginProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& /*mid
     int nCurrentBlockSize = nHostBlockSize = buffer.getNumSamples();
     nNumInputs = jmin(getTotalNumInputChannels(), buffer.getNumChannels(), 256);
     nNumOutputs = jmin(getTotalNumOutputChannels(), buffer.getNumChannels(), 256);
-    float* const* bufferData = buffer.getArrayOfWritePointers(); 
+    float* const* bufferData = buffer.getArrayOfWritePointers();
     float* pFrameData[256];
-    int frameSize = hades_renderer_getFrameSize();
+    for(int ch = 0; ch < jmin(buffer.getNumChannels(), 256); ch++)
+        pFrameData[ch] = bufferData[ch];
 
-    if(nCurrentBlockSize % frameSize == 0){ /* divisible by frame size */
-        for(int frame = 0; frame < nCurrentBlockSize/frameSize; frame++) {
-            for(int ch = 0; ch < jmin(buffer.getNumChannels(), 256); ch++)
-                pFrameData[ch] = &bufferData[ch][frame*frameSize];
-
-            /* perform processing */
-            hades_renderer_process(hHdR, pFrameData, pFrameData, nNumInputs, nNumOutputs, frameSize);
-        }
-    }
-    else
-        buffer.clear();
+    /* perform processing (any block size is supported, thanks to the internal FIFO buffer) */
+    hades_renderer_process(hHdR, pFrameData, pFrameData, nNumInputs, nNumOutputs, nCurrentBlockSize);
 }
 
 //==============================================================================
@@ -208,11 +211,19 @@ void PluginProcessor::getStateInformation (MemoryBlock& destData)
     xml.setAttribute("DoAestimator", String(hades_renderer_getDoAestimator(hHdR)));
     xml.setAttribute("DiffEstimator", String(hades_renderer_getDiffusenessEstimator(hHdR)));
     xml.setAttribute("beamformerType", String(hades_renderer_getBeamformer(hHdR)));
+    xml.setAttribute("hrtfInterpMode", String(hades_renderer_getHRTFinterpMode(hHdR)));
+    xml.setAttribute("irTruncationEnable", String(hades_renderer_getEnableIRtruncation(hHdR)));
+    xml.setAttribute("targetNDirsArray", String(hades_renderer_getTargetNDirsArray(hHdR)));
+    xml.setAttribute("maxSteeringErrorArray", String(hades_renderer_getMaxSteeringErrorArray(hHdR)));
     xml.setAttribute("covMatchingEnable", String(hades_renderer_getEnableCovMatching(hHdR)));
     xml.setAttribute("analysisAveraging", String(hades_renderer_getAnalysisAveraging(hHdR)));
     xml.setAttribute("synthesisAveraging", String(hades_renderer_getSynthesisAveraging(hHdR)));
     xml.setAttribute("refSensorIndexLEFT", String(hades_renderer_getReferenceSensorIndex(hHdR, 0)));
     xml.setAttribute("refSensorIndexRIGHT", String(hades_renderer_getReferenceSensorIndex(hHdR, 1)));
+    xml.setAttribute("frameSize", String(hades_renderer_getFrameSize(hHdR)));
+    xml.setAttribute("crossfadeFrames", String(hades_renderer_getCrossfadeLength(hHdR)));
+    xml.setAttribute("enableSilenceGate", String(hades_renderer_getEnableSilenceGate(hHdR)));
+    xml.setAttribute("enablePipelining", String(hades_renderer_getEnablePipelining(hHdR)));
 
     //if(!hades_renderer_getSofaFilePathMAIR(hHdR))
          xml.setAttribute("SofaFilePath_MAIR", String(hades_renderer_getSofaFilePathMAIR(hHdR)));
@@ -253,6 +264,14 @@ void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
                 hades_renderer_setDiffusenessEstimator(hHdR, (HADES_RENDERER_DIFFUSENESS_ESTIMATORS)xmlState->getIntAttribute("DiffEstimator",1));
             if(xmlState->hasAttribute("beamformerType"))
                 hades_renderer_setBeamformer(hHdR, (HADES_RENDERER_BEAMFORMER_TYPE)xmlState->getIntAttribute("beamformerType",1));
+            if(xmlState->hasAttribute("hrtfInterpMode"))
+                hades_renderer_setHRTFinterpMode(hHdR, (HADES_RENDERER_HRTF_INTERP_OPTIONS)xmlState->getIntAttribute("hrtfInterpMode",1));
+            /* (projects saved before IR truncation existed load with it disabled) */
+            hades_renderer_setEnableIRtruncation(hHdR, xmlState->getIntAttribute("irTruncationEnable",0));
+            if(xmlState->hasAttribute("targetNDirsArray"))
+                hades_renderer_setTargetNDirsArray(hHdR, xmlState->getIntAttribute("targetNDirsArray",0));
+            if(xmlState->hasAttribute("maxSteeringErrorArray"))
+                hades_renderer_setMaxSteeringErrorArray(hHdR, (float)xmlState->getDoubleAttribute("maxSteeringErrorArray",-10.0));
             if(xmlState->hasAttribute("covMatchingEnable"))
                 hades_renderer_setEnableCovMatching(hHdR, xmlState->getIntAttribute("covMatchingEnable",1));
             if(xmlState->hasAttribute("analysisAveraging"))
@@ -263,6 +282,14 @@ void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
                 hades_renderer_setReferenceSensorIndex(hHdR, 0, xmlState->getIntAttribute("refSensorIndexLEFT",1));
             if(xmlState->hasAttribute("refSensorIndexRIGHT"))
                 hades_renderer_setReferenceSensorIndex(hHdR, 1, xmlState->getIntAttribute("refSensorIndexRIGHT",1));
+            if(xmlState->hasAttribute("frameSize"))
+                hades_renderer_setFrameSize(hHdR, xmlState->getIntAttribute("frameSize",1024));
+            if(xmlState->hasAttribute("crossfadeFrames"))
+                hades_renderer_setCrossfadeLength(hHdR, xmlState->getIntAttribute("crossfadeFrames",0));
+            if(xmlState->hasAttribute("enableSilenceGate"))
+                hades_renderer_setEnableSilenceGate(hHdR, xmlState->getIntAttribute("enableSilenceGate",0));
+            if(xmlState->hasAttribute("enablePipelining"))
+                hades_renderer_setEnablePipelining(hHdR, xmlState->getIntAttribute("enablePipelining",0));
 
             hades_renderer_refreshSettings(hHdR);
         }
@@ -20,7 +20,6 @@
 
 #include "JuceHeader.h" 
 #include "ehades.h"
-#include <thread> 
 #define BUILD_VER_SUFFIX "alpha"
 #define DEFAULT_OSC_PORT 9000
 #ifndef MIN
@@ -72,15 +71,11 @@ private:
     void timerCallback(int timerID) override {
         switch(timerID){
             case TIMER_PROCESSING_RELATED:
-                /* reinitialise codec if needed */
-                if(hades_renderer_getCodecStatus(hHdR) == CODEC_STATUS_NOT_INITIALISED){
-                    try{
-                        std::thread threadInit(hades_renderer_initCodec, hHdR);
-                        threadInit.detach();
-                    } catch (const std::exception& exception) {
-                        std::cout << "Could not create thread" << exception.what() << std::endl;
-                    }
-                }
+                /* (the codec is reinitialised by its own background service, as soon as the settings change) */
+                /* report the processing delay (including the FIFO buffering) to the host */
+                if(hades_renderer_getCodecStatus(hHdR) == CODEC_STATUS_INITIALISED &&
+                   getLatencySamples() != hades_renderer_getProcessingDelay(hHdR))
+                    setLatencySamples(hades_renderer_getProcessingDelay(hHdR));
                 break;
                 
             case TIMER_GUI_RELATED:
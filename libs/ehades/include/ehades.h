@@ -34,6 +34,8 @@
 #ifndef __EHADES_H_INCLUDED__
 #define __EHADES_H_INCLUDED__
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -64,22 +66,92 @@ typedef enum {
                                                *   (MVDR) beamforming */
 }HADES_RENDERER_BEAMFORMER_TYPE;
 
+/**
+ * Options for obtaining the HRTFs for the directions of the analysis grid
+ *
+ * Either way, a table holding one HRTF per grid direction and band is computed
+ * in the filterbank domain when the codec is initialised, so that rendering
+ * only ever looks up the HRTF for the estimated DoA. The table is the same
+ * size for both options; triangular interpolation takes longer to compute it.
+ */
+typedef enum {
+    HADES_RENDERER_HRTF_INTERP_NEAREST = 1,   /**< HRTF of the nearest HRIR
+                                               *   measurement direction */
+    HADES_RENDERER_HRTF_INTERP_TRIANGULAR     /**< Triangular (VBAP) weighting
+                                               *   of the three surrounding
+                                               *   HRIR measurements, with
+                                               *   magnitudes and ITDs
+                                               *   interpolated separately */
+}HADES_RENDERER_HRTF_INTERP_OPTIONS;
+
 /**
  * Current status of the codec
  *
  * These can be used to find out whether the codec is initialised, currently
- * in the process of intialising, or it is not yet initialised.
+ * in the process of intialising, or it is not yet initialised. Note that while
+ * the codec is being reinitialised, the audio continues to be processed using
+ * the previous configuration (if there is one), and the new configuration
+ * takes over once it is ready.
  */
 typedef enum {
     CODEC_STATUS_INITIALISED = 0, /**< Codec is initialised and ready to process
                                    *   input audio. */
     CODEC_STATUS_NOT_INITIALISED, /**< Codec has not yet been initialised, or
-                                   *   the codec configuration has changed.
-                                   *   Input audio should not be processed. */
-    CODEC_STATUS_INITIALISING     /**< Codec is currently being initialised,
-                                   *   input audio should not be processed. */
+                                   *   the codec configuration has changed. */
+    CODEC_STATUS_INITIALISING     /**< Codec is currently being initialised */
 } HADES_CODEC_STATUS;
 
+/**
+ * Phases of a codec initialisation, as profiled by
+ * hades_renderer_getInitProfile()
+ *
+ * Only the phases affected by the settings that changed are run upon a
+ * reinitialisation; the rest are shared with the previous configuration.
+ */
+typedef enum {
+    HADES_RENDERER_INIT_PHASE_MAIR_LOAD = 0, /**< Loading the microphone array
+                                              *   IRs (SOFA parsing, or the IR
+                                              *   cache, and resampling) */
+    HADES_RENDERER_INIT_PHASE_ANALYSIS,      /**< Creating the analysis */
+    HADES_RENDERER_INIT_PHASE_RADIAL_EDITOR, /**< Creating the parameter radial
+                                              *   editor */
+    HADES_RENDERER_INIT_PHASE_CONTAINERS,    /**< Creating the parameter/signal
+                                              *   containers */
+    HADES_RENDERER_INIT_PHASE_HRIR_LOAD,     /**< Loading the HRIRs */
+    HADES_RENDERER_INIT_PHASE_SYNTHESIS,     /**< Creating the synthesis */
+    HADES_RENDERER_INIT_PHASE_PUBLISH,       /**< Handing the new configuration
+                                              *   over to the processing loop,
+                                              *   and retiring the old one */
+
+    HADES_RENDERER_NUM_INIT_PHASES           /**< Number of phases */
+} HADES_RENDERER_INIT_PHASES;
+
+/** Resources spent on one phase of a codec initialisation */
+typedef struct _hades_renderer_init_phase_profile {
+    int ran;                  /**< 1: the phase was run, 0: it was skipped */
+    double wallTime_ms;       /**< Elapsed (wall-clock) time, in ms */
+    double cpuTime_ms;        /**< CPU time of the initialising thread, in ms
+                               *   (work handed to the worker threads is not
+                               *   included) */
+    size_t peakMemoryIncrease;/**< Increase in the peak resident memory of the
+                               *   process, in bytes (0 if the phase stayed
+                               *   below an earlier peak) */
+} hades_renderer_init_phase_profile;
+
+/** Resources spent on a codec initialisation, in total and per phase */
+typedef struct _hades_renderer_init_profile {
+    int nInits;               /**< Number of initialisations completed so far
+                               *   (0: none, and the rest is all zeros) */
+    int nCancelled;           /**< Number of initialisations cancelled so far,
+                               *   due to the settings changing */
+    double wallTime_ms;       /**< Elapsed (wall-clock) time, in ms */
+    double cpuTime_ms;        /**< CPU time of the initialising thread, in ms */
+    size_t peakMemoryIncrease;/**< Increase in the peak resident memory of the
+                               *   process, in bytes */
+    hades_renderer_init_phase_profile phases[HADES_RENDERER_NUM_INIT_PHASES];
+                              /**< Per phase; see #HADES_RENDERER_INIT_PHASES */
+} hades_renderer_init_profile;
+
 /** Length of progress bar string */
 #define HADES_PROGRESSBARTEXT_CHAR_LENGTH ( 256 )
 
@@ -92,6 +164,9 @@ typedef enum {
 /** Maximum number of output channels supported */
 #define HADES_MAX_NUM_OUTPUTS ( HADES_MAX_NUM_CHANNELS )
 
+/** Maximum crossfade length (in frames) between codec configurations */
+#define HADES_MAX_CROSSFADE_FRAMES ( 8 )
+
 /* ========================================================================== */
 /*                               Main Functions                               */
 /* ========================================================================== */
@@ -122,13 +197,49 @@ void hades_renderer_init(void* const hHdR,
 /**
  * Intialises the compass codecs based on current global/user parameters
  *
+ * If the settings are changed while this is running, then it stops at the
+ * next stage boundary (the current codec keeps processing audio), and the
+ * codec status reverts to #CODEC_STATUS_NOT_INITIALISED, so that it may be
+ * called again to pick up the new settings.
+ *
  * @param[in] hHdR hades_renderer handle
  */
 void hades_renderer_initCodec(void* const hHdR);
 
+/**
+ * Starts a background thread, which calls hades_renderer_initCodec() as soon
+ * as the settings are changed (so the host no longer needs to poll the codec
+ * status), and abandons initialisations that newer settings have made stale
+ *
+ * The thread runs at a reduced priority, and is stopped by
+ * hades_renderer_stopInitService() or hades_renderer_destroy(). Calling this
+ * when the service is already running does nothing.
+ *
+ * @param[in] hHdR hades_renderer handle
+ * @returns 1 if the service is running, 0 if the thread could not be started
+ */
+int hades_renderer_startInitService(void* const hHdR);
+
+/**
+ * Stops the background initialisation thread, if it was started
+ *
+ * An initialisation that the thread is running is abandoned at its next stage
+ * boundary (and waited for), leaving the codec status as
+ * #CODEC_STATUS_NOT_INITIALISED. Start/stop the service from the same thread
+ * that changes the settings.
+ *
+ * @param[in] hHdR hades_renderer handle
+ */
+void hades_renderer_stopInitService(void* const hHdR);
+
 /**
  * Performs the HADES processing
  *
+ * The input/output signals are passed through an internal FIFO buffer, so any
+ * number of samples may be given per call. This adds hades_renderer_getFrameSize()
+ * samples of latency, which is included in hades_renderer_getProcessingDelay().
+ * The 'inputs' and 'outputs' buffers may point to the same memory.
+ *
  * @param[in] hHdR     hades_renderer handle
  * @param[in] inputs   Input channel buffers; 2-D array: nInputs x nSamples
  * @param[in] outputs  Output channel buffers; 2-D array: nOutputs x nSamples
@@ -143,6 +254,38 @@ void hades_renderer_process(void* const hHdR,
                             int nOutputs,
                             int nSamples);
 
+/**
+ * Performs the HADES processing for exactly one frame, directly on the given
+ * buffers (i.e., without the internal FIFO buffer)
+ *
+ * The input channels are read in place, and the binaural signals are written
+ * straight into the first two output channels. Only the first 'nMics' input
+ * channels are ever read (missing ones are treated as silent), and any output
+ * channels beyond the first two are zeroed. The 'inputs' and 'outputs' buffers
+ * may point to the same memory, since all inputs are consumed before any
+ * outputs are written.
+ *
+ * Since there is no FIFO buffering, the delay is hades_renderer_getFrameSize()
+ * samples shorter than hades_renderer_getProcessingDelay(). Note that this
+ * function and hades_renderer_process() should not be used interchangeably on
+ * the same handle.
+ *
+ * @param[in] hHdR     hades_renderer handle
+ * @param[in] inputs   Input channel buffers; 2-D array: nInputs x nSamples
+ * @param[in] outputs  Output channel buffers; 2-D array: nOutputs x nSamples
+ * @param[in] nInputs  Number of input channels
+ * @param[in] nOutputs Number of output channels
+ * @param[in] nSamples Number of samples in 'inputs'/'output' matrices; must be
+ *                     equal to hades_renderer_getFrameSize(), otherwise (or if
+ *                     the codec is not ready) the outputs are zeroed
+ */
+void hades_renderer_processFrame(void* const hHdR,
+                                 const float *const * inputs,
+                                 float* const* const outputs,
+                                 int nInputs,
+                                 int nOutputs,
+                                 int nSamples);
+
 
 /* ========================================================================== */
 /*                                Set Functions                               */
@@ -176,6 +319,76 @@ void hades_renderer_setBeamformer(void* const hHdR,
 void hades_renderer_setEnableCovMatching(void* const hHdR,
                                          int newState);
 
+/**
+ * Sets how the HRTFs are obtained for the analysis grid directions, when they
+ * do not coincide with the HRIR measurement directions (see
+ * #HADES_RENDERER_HRTF_INTERP_OPTIONS)
+ */
+void hades_renderer_setHRTFinterpMode(void* const hHdR,
+                                      HADES_RENDERER_HRTF_INTERP_OPTIONS newMode);
+
+/**
+ * Sets the processing frame size, in samples
+ *
+ * The analysis, radial editor and synthesis are applied every time this many
+ * samples have been buffered. Smaller frame sizes reduce the latency and spread
+ * the processing more evenly over time, at the cost of more overhead. The value
+ * is rounded down to a multiple of hades_renderer_getHopSize(), and is limited
+ * to the range [hop size, 1024]. Note: the codec is reinitialised, and the
+ * averaging coefficients are reset to values that give the same time constant
+ * for the new frame size.
+ */
+void hades_renderer_setFrameSize(void* const hHdR,
+                                 int newFrameSize);
+
+/**
+ * Sets the length of the crossfade applied after a reinitialisation, in frames
+ *
+ * When enabled, the outgoing configuration keeps running alongside the new one
+ * after it is published. Its output is kept until the new filterbanks have
+ * filled (see hades_renderer_getCrossfadeWindow()), and is then faded out over
+ * this many frames, while the new output is faded in. This allows settings to
+ * be changed during playback without audible clicks. No crossfade is applied if
+ * the number of microphones or the frame size differ between the two. During a
+ * crossfade, the two configurations are processed in parallel (the calling
+ * thread is helped by a worker thread).
+ *
+ * The initialisation does not wait for the crossfade; the outgoing
+ * configuration is freed by the initialisation service once it has finished
+ * (see hades_renderer_startInitService()), or else upon the next
+ * reinitialisation.
+ *
+ * @param[in] hHdR     hades_renderer handle
+ * @param[in] nFrames  Crossfade length, in frames; 0: disabled (default),
+ *                     up to #HADES_MAX_CROSSFADE_FRAMES
+ */
+void hades_renderer_setCrossfadeLength(void* const hHdR,
+                                       int nFrames);
+
+/**
+ * Sets whether the analysis and synthesis should be bypassed while the input
+ * is silent (1) or not (0, default)
+ *
+ * When enabled, once all input channels have been silent (below -120 dBFS) for
+ * longer than the filterbank tail, the outputs are simply zeroed. When signal
+ * returns, the codec resumes from cleared filterbank/averaging states.
+ */
+void hades_renderer_setEnableSilenceGate(void* const hHdR,
+                                         int newState);
+
+/**
+ * Sets whether the analysis and synthesis should be pipelined (1) or not (0,
+ * default)
+ *
+ * When pipelined, the analysis (and radial editor) of each frame runs on a
+ * worker thread, while the synthesis of the previous frame runs on the calling
+ * thread. This shortens the time spent in each call, at the cost of one extra
+ * frame of latency, which is included in hades_renderer_getProcessingDelay().
+ * Note: the codec is reinitialised.
+ */
+void hades_renderer_setEnablePipelining(void* const hHdR,
+                                        int newState);
+
 /** Sets the analysis averaging coefficient, [0..1] */
 void hades_renderer_setAnalysisAveraging(void* const hHdR,
                                          float newValue);
@@ -223,6 +436,9 @@ void hades_renderer_setStreamBalanceAllBands(void* const hHdR,
 /**
  * Sets the file path for a .sofa file
  *
+ * @note Arrays with more than HADES_MAX_NUM_INPUTS sensors are rejected (in
+ *       the same way as invalid files)
+ *
  * @param[in] hHdR       hades_renderer handle
  * @param[in] path       File path to .sofa file (WITH file extension)
  */
@@ -249,16 +465,113 @@ void hades_renderer_setUseDefaultHRIRsflag(void* const hHdR, int newState);
  */
 void hades_renderer_setSofaFilePathHRIR(void* const hHdR, const char* path);
 
+/**
+ * Sets the directory for the on-disk IR cache
+ *
+ * The IRs loaded from each SOFA file are stored in this directory, keyed by
+ * the file contents, the sample rate and the load-time reduction, so that
+ * subsequent initialisations map them straight from the cache instead of
+ * parsing the SOFA file again. Entries are validated when read, and are safe
+ * to delete at any time. The directory must already exist.
+ *
+ * @param[in] hHdR hades_renderer handle
+ * @param[in] path Cache directory; NULL or empty: caching is disabled (default)
+ */
+void hades_renderer_setCacheDirectory(void* const hHdR, const char* path);
+
+/**
+ * Sets the size limit of the on-disk IR cache
+ *
+ * Whenever an entry is added, the least recently used entries are removed
+ * until the cache fits within this limit (the new entry is always kept). The
+ * limit applies to the whole directory, so instances sharing a directory
+ * should use the same limit.
+ *
+ * @param[in] hHdR     hades_renderer handle
+ * @param[in] limit_MB Size limit, in MB; 0: no limit (default: 1024)
+ */
+void hades_renderer_setCacheSizeLimit(void* const hHdR, int limit_MB);
+
+/**
+ * Sets whether the leading and trailing near-silence is trimmed from the array
+ * IRs upon loading (1) or not (0, default)
+ *
+ * The same samples are trimmed from every IR, such that each end holds no
+ * more than -60 dB of the total IR energy (with a 0.5 ms margin either side,
+ * which is faded out at the end). So, only the common delay of the IRs
+ * changes, and not the differences between them. Shorter IRs shorten the
+ * initialisation, and reduce the memory taken by the analysis. The resulting
+ * length is returned by hades_renderer_getIRlengthArray().
+ */
+void hades_renderer_setEnableIRtruncation(void* const hHdR, int newState);
+
+/**
+ * Sets the number of directions that the array IR measurement grid is
+ * decimated to upon loading
+ *
+ * The directions are first chosen such that they cover the measurement grid
+ * as evenly as possible. Dropped directions are then added back, until every
+ * dropped direction is within hades_renderer_setMaxSteeringErrorArray() of
+ * its nearest kept direction; so more directions may be kept than requested.
+ * The resulting number is returned by hades_renderer_getNDirsArray(). Fewer
+ * directions shorten the initialisation, reduce the memory taken by the
+ * analysis and synthesis tables, and reduce the cost of the MUSIC DoA
+ * estimation every frame, at the expense of a coarser DoA resolution.
+ *
+ * @param[in] hHdR  hades_renderer handle
+ * @param[in] nDirs Target number of directions; 0: all are kept (default)
+ */
+void hades_renderer_setTargetNDirsArray(void* const hHdR, int nDirs);
+
+/**
+ * Sets the largest steering-vector error permitted by the decimation of the
+ * array IR measurement grid (see hades_renderer_setTargetNDirsArray()), in dB
+ *
+ * The error between two directions is evaluated in third-octave bands: per
+ * band, it is one minus the squared normalised inner product of their array
+ * responses (i.e. the part of the response of one that is not explained by
+ * that of the other), and the largest over the bands is compared with the
+ * bound. Bands more than 60 dB below the strongest band of a direction are
+ * left out.
+ *
+ * @param[in] hHdR     hades_renderer handle
+ * @param[in] newValue Error bound, in dB, [-40..0] (default -10); 0: unbounded
+ */
+void hades_renderer_setMaxSteeringErrorArray(void* const hHdR, float newValue);
+
 
 /* ========================================================================== */
 /*                                Get Functions                               */
 /* ========================================================================== */
 
 /**
- * Returns the processing framesize (i.e., number of samples processed with
- * every _process() call )
+ * Returns the processing framesize (i.e., number of samples processed by the
+ * analysis/synthesis each time the internal FIFO buffer is full)
  */
-int hades_renderer_getFrameSize(void);
+int hades_renderer_getFrameSize(void* const hHdR);
+
+/**
+ * Returns the filterbank hop size (i.e., the smallest supported processing
+ * framesize)
+ */
+int hades_renderer_getHopSize(void);
+
+/** Returns whether the silence gate is enabled (1) or not (0) */
+int hades_renderer_getEnableSilenceGate(void* const hHdR);
+
+/** Returns whether the analysis and synthesis are pipelined (1) or not (0) */
+int hades_renderer_getEnablePipelining(void* const hHdR);
+
+/** Returns the crossfade length, in frames (0: disabled) */
+int hades_renderer_getCrossfadeLength(void* const hHdR);
+
+/**
+ * Returns the number of samples, following a reinitialisation, during which
+ * both the outgoing and incoming configurations are processed (i.e., the
+ * window over which the processing cost is doubled); 0 if crossfading is
+ * disabled
+ */
+int hades_renderer_getCrossfadeWindow(void* const hHdR);
 
 /**
  * Returns current codec status (see #HADES_CODEC_STATUS enum)
@@ -269,6 +582,9 @@ HADES_CODEC_STATUS hades_renderer_getCodecStatus(void* const hHdR);
  * Returns current intialisation/processing progress, between 0..1
  *  - 0: intialisation/processing has started
  *  - 1: intialisation/processing has ended
+ *
+ * @note Converting the IRs advances the progress per direction; the other
+ *       stages only advance it once they have finished
  */
 float hades_renderer_getProgressBar0_1(void* const hHdR);
 
@@ -301,6 +617,12 @@ HADES_RENDERER_BEAMFORMER_TYPE hades_renderer_getBeamformer(void* const hHdR);
 /** Returns whether the covariance matching is being applied (1) or not (0) */
 int hades_renderer_getEnableCovMatching(void* const hHdR);
 
+/**
+ * Returns how the HRTFs are obtained for the analysis grid directions (see
+ * #HADES_RENDERER_HRTF_INTERP_OPTIONS)
+ */
+HADES_RENDERER_HRTF_INTERP_OPTIONS hades_renderer_getHRTFinterpMode(void* const hHdR);
+
 /** Returns the analysis averaging coefficient, [0..1] */
 float hades_renderer_getAnalysisAveraging(void* const hHdR);
 
@@ -365,22 +687,34 @@ int hades_renderer_getNumberOfBands(void* const hHdR);
 /** Returns the number of microphones in the currently used array */
 int hades_renderer_getNmicsArray(void* const hHdR);
 
-/** Returns the number of directions in the currently used array IR set */
+/**
+ * Returns the number of directions in the currently used array IR set (after
+ * any decimation; see hades_renderer_setTargetNDirsArray())
+ */
 int hades_renderer_getNDirsArray(void* const hHdR);
 
-/** Returns the length of the array IRs, in samples */
+/**
+ * Returns the length of the array IRs, in samples (at the DAW/Host sample
+ * rate, and after any truncation; see hades_renderer_setEnableIRtruncation())
+ */
 int hades_renderer_getIRlengthArray(void* const hHdR);
 
-/** Returns the array IR sample rate */
+/**
+ * Returns the sample rate of the array IR measurements (if it differs from the
+ * DAW/Host sample rate, then the IRs are converted upon loading)
+ */
 int hades_renderer_getIRsamplerateArray(void* const hHdR);
 
 /** Returns the number of directions in the currently used HRIR set */
 int hades_renderer_getNDirsBin(void* const hHdR);
 
-/** Returns the length of the HRIRs, in samples */
+/** Returns the length of the HRIRs, in samples (at the DAW/Host sample rate) */
 int hades_renderer_getIRlengthBin(void* const hHdR);
 
-/** Returns the HRIR sample rate */
+/**
+ * Returns the sample rate of the HRIR measurements (if it differs from the
+ * DAW/Host sample rate, then the HRIRs are converted upon loading)
+ */
 int hades_renderer_getIRsamplerateBin(void* const hHdR);
 
 /** Returns the DAW/Host sample rate */
@@ -413,11 +747,73 @@ int hades_renderer_getUseDefaultHRIRsflag(void* const hHdR);
 char* hades_renderer_getSofaFilePathHRIR(void* const hHdR);
 
 /**
- * Returns the processing delay in samples (may be used for delay compensation
- * features)
+ * Returns the directory for the on-disk IR cache ("" if caching is disabled)
+ */
+const char* hades_renderer_getCacheDirectory(void* const hHdR);
+
+/** Returns the size limit of the on-disk IR cache, in MB (0: no limit) */
+int hades_renderer_getCacheSizeLimit(void* const hHdR);
+
+/**
+ * Returns whether the near-silence is trimmed from the array IRs upon loading
+ * (1) or not (0)
+ */
+int hades_renderer_getEnableIRtruncation(void* const hHdR);
+
+/**
+ * Returns the number of directions that the array IR measurement grid is
+ * decimated to upon loading (0: all are kept)
+ */
+int hades_renderer_getTargetNDirsArray(void* const hHdR);
+
+/** Returns the steering-vector error bound of the grid decimation, in dB */
+float hades_renderer_getMaxSteeringErrorArray(void* const hHdR);
+
+/**
+ * Returns the memory occupied by the IR data (microphone array IRs and HRIRs)
+ * that this instance holds
+ *
+ * Instances that load the same SOFA files, at the same sample rate, share a
+ * single copy of this data.
+ *
+ * @param[in]  hHdR         hades_renderer handle
+ * @param[out] sharedBytes  (&) Bytes that are shared with other instances
+ * @param[out] privateBytes (&) Bytes that are held by this instance alone
+ */
+void hades_renderer_getDataMemoryUsage(void* const hHdR,
+                                       size_t* sharedBytes,
+                                       size_t* privateBytes);
+
+/**
+ * Returns the memory occupied by the IR data of all instances in the process
+ *
+ * @param[out] nDatasets     (&) Number of distinct IR sets currently loaded
+ * @param[out] residentBytes (&) Memory they occupy, in bytes
+ * @param[out] savedBytes    (&) Memory saved by sharing them, in bytes
+ */
+void hades_renderer_getProcessDataMemoryUsage(int* nDatasets,
+                                              size_t* residentBytes,
+                                              size_t* savedBytes);
+
+/**
+ * Returns the processing delay in samples, including the FIFO buffering and
+ * the extra frame when pipelined (may be used for delay compensation features)
  */
 int hades_renderer_getProcessingDelay(void* const hHdR);
 
+/**
+ * Returns the time and memory spent on the most recently completed codec
+ * initialisation, in total and for each of its phases
+ *
+ * The peak memory is that of the whole process, so it may also include
+ * allocations made by other threads (or instances) in the meantime.
+ *
+ * @param[in]  hHdR    hades_renderer handle
+ * @param[out] profile (&) Profile of the last initialisation
+ */
+void hades_renderer_getInitProfile(void* const hHdR,
+                                   hades_renderer_init_profile* profile);
+
 
 #ifdef __cplusplus
 } /* extern "C" */
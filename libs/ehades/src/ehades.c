@@ -34,6 +34,73 @@
 #include "ehades.h"
 #include "ehades_internal.h"
 
+/* Build order of the codec stages, and their rough relative initialisation times (for the progress bar) */
+#define NUM_CODEC_STAGES ( 5 )
+static const int codecStageOrder[NUM_CODEC_STAGES] = { STAGE_MAIR_SET, STAGE_ANALYSIS, STAGE_CONTAINERS, STAGE_HRIR_SET, STAGE_SYNTHESIS };
+static const float codecStageWeight[NUM_CODEC_STAGES] = { 3.0f, 3.0f, 0.5f, 2.0f, 3.0f };
+
+/* Points 'progress' at the part of the progress bar covered by 'stage', out of the stages being rebuilt */
+static void hades_renderer_beginStage(hades_renderer_data* const pData, hades_progress* const progress, int dirty, int stage, const char* text)
+{
+    float total, before, weight;
+    int i;
+
+    total = before = weight = 0.0f;
+    for(i=0; i<NUM_CODEC_STAGES; i++){
+        if(dirty & codecStageOrder[i]){
+            if(codecStageOrder[i]==stage){
+                before = total;
+                weight = codecStageWeight[i];
+            }
+            total += codecStageWeight[i];
+        }
+    }
+    progress->bar = &pData->progressBar0_1;
+    progress->start = total>0.0f ? 0.95f*before/total : 0.0f; /* (the last 5% is for publishing the new generation) */
+    progress->span = total>0.0f ? 0.95f*weight/total : 0.0f;
+    strcpy(pData->progressBarText, text);
+    hades_progress_begin(progress, 1);
+}
+
+/* Resources in use at the start of an initialisation phase */
+typedef struct _hades_phase_start {
+    double wallTime_ms;
+    double cpuTime_ms;
+    size_t peakBytes;
+} hades_phase_start;
+
+static void hades_renderer_startPhase(hades_phase_start* const start)
+{
+    start->wallTime_ms = hades_getWallTime_ms();
+    start->cpuTime_ms = hades_getThreadCpuTime_ms();
+    start->peakBytes = hades_getPeakResidentBytes();
+}
+
+/* Records the resources spent since hades_renderer_startPhase() */
+static void hades_renderer_endPhase(const hades_phase_start* const start, hades_renderer_init_phase_profile* const phase)
+{
+    size_t peakBytes;
+
+    peakBytes = hades_getPeakResidentBytes();
+    phase->ran = 1;
+    phase->wallTime_ms = hades_getWallTime_ms() - start->wallTime_ms;
+    phase->cpuTime_ms = hades_getThreadCpuTime_ms() - start->cpuTime_ms;
+    phase->peakMemoryIncrease = peakBytes>start->peakBytes ? peakBytes-start->peakBytes : 0;
+}
+
+/* Returns a copy of a path, made under the path lock (NULL stays NULL) */
+static char* hades_renderer_copyPath(hades_renderer_data* const pData, char* const* path)
+{
+    char* copy;
+
+    hades_mutex_lock(&pData->pathLock);
+    copy = *path==NULL ? NULL : (char*)malloc1d(strlen(*path) + 1);
+    if(copy!=NULL)
+        strcpy(copy, *path);
+    hades_mutex_unlock(&pData->pathLock);
+    return copy;
+}
+
 void hades_renderer_create
 (
     void ** const phHdR
@@ -47,28 +114,66 @@ void hades_renderer_create
     pData->sofa_filepath_MAIR = NULL;
     pData->useDefaultHRIRsFLAG = 1;
     pData->sofa_filepath_HRIR = NULL;
+    pData->cacheDirectory = NULL;
+    pData->cacheSizeLimit_MB = DEFAULT_CACHE_SIZE_LIMIT_MB;
+    pData->mairReduction.truncate = 0;
+    pData->mairReduction.targetNumDirs = 0;
+    pData->mairReduction.maxSteeringError_dB = -10.0f;
+    hades_mutex_create(&pData->pathLock);
     pData->binConfig.lHRIR = pData->binConfig.nHRIR = pData->binConfig.hrir_fs = 0;
     pData->binConfig.hrirs = NULL;
     pData->binConfig.hrir_dirs_deg = NULL;
+    pData->mairSet = NULL;
+    pData->hrirSet = NULL;
     pData->refsensor_idx[0] = pData->refsensor_idx[1] = -1;
     pData->diffOption = HADES_RENDERER_USE_COMEDIE;
     pData->doaOption  = HADES_RENDERER_USE_MUSIC;
     pData->beamOption = HADES_RENDERER_BEAMFORMER_FILTER_AND_SUM;
+    pData->interpOption = HADES_RENDERER_HRTF_INTERP_NEAREST;
     pData->enableCovMatching = 0; 
+    pData->frameSize = DEFAULT_FRAME_SIZE;
+    pData->crossfadeFrames = 0;
+    pData->enableSilenceGate = 0;
+    pData->enablePipelining = 0;
 
     /* Default values for the radial editor */
     for(i=0; i<360; i++)
         pData->dirGain_dB[i] = 0.0f;
 
+    /* FIFO buffers */
+    pData->FIFO_idx = 0;
+    pData->inFIFO = (float**)calloc2d(HADES_MAX_NUM_INPUTS, MAX_FRAME_SIZE, sizeof(float));
+    pData->outFIFO = (float**)calloc2d(NUM_EARS, MAX_FRAME_SIZE, sizeof(float));
+
+    /* Crossfading */
+    pData->fadeGenId = 0;
+    pData->fadeFrameIdx = 0;
+    pData->fadeFrameTD = (float**)calloc2d(NUM_EARS, MAX_FRAME_SIZE, sizeof(float));
+    pData->newFrameTD = (float**)calloc2d(NUM_EARS, MAX_FRAME_SIZE, sizeof(float));
+    pData->pipeInFrameTD = (float**)calloc2d(HADES_MAX_NUM_INPUTS, MAX_FRAME_SIZE, sizeof(float));
+
+    /* Frame-based processing */
+    pData->zeroFrame = (float*)calloc1d(MAX_FRAME_SIZE, sizeof(float));
+    pData->discardFrameTD = (float**)calloc2d(NUM_EARS, MAX_FRAME_SIZE, sizeof(float));
+
+    /* Silence gate */
+    pData->silentSamples = 0;
+    pData->isGated = 0;
+
     /* internal parameters */
-    pData->inputFrameTD =  (float**)malloc2d(HADES_MAX_NUM_CHANNELS, FRAME_SIZE, sizeof(float));
-    pData->outputFrameTD = (float**)malloc2d(NUM_EARS, FRAME_SIZE, sizeof(float));
     pData->fs = 48000.0f;
-    pData->hAna = NULL;
-    pData->hSyn = NULL;
-    pData->hPCon = NULL;
-    pData->hSCon = NULL;
-    pData->hREd = NULL;
+    atomic_init(&pData->codecGen, NULL);
+    atomic_init(&pData->procGen, NULL);
+    atomic_init(&pData->ctrlGen, NULL);
+    hades_mutex_create(&pData->ctrlLock);
+    hades_mutex_create(&pData->retireLock);
+    hades_waitable_create(&pData->statusChanged);
+    hades_post_service_retain();
+    pData->genCounter = 0;
+    pData->initService = NULL;
+    atomic_init(&pData->cancelInit, 0);
+    hades_mutex_create(&pData->profileLock);
+    memset(&pData->initProfile, 0, sizeof(hades_renderer_init_profile));
 
     /* Local copy of internal parameter vectors (for optional thread-safe GUI plotting) */
     pData->nBands_local = 0;
@@ -76,18 +181,18 @@ void hades_renderer_create
     pData->streamBalBands_local = NULL;
 
     /* our codec data */
-    pData->progressBar0_1 = 0.0f;
+    atomic_init(&pData->progressBar0_1, 0.0f);
     pData->progressBarText = malloc1d(HADES_PROGRESSBARTEXT_CHAR_LENGTH*sizeof(char));
     strcpy(pData->progressBarText,"");
 
     /* Default IR data */
     pData->nMics = pData->nDirs = pData->IRlength = 0;
-    pData->IR_fs = 0.0f;
+    pData->IR_fs = pData->HRIR_fs = 0.0f;
     
     /* flags */
     pData->MAIR_SOFA_isLoadedFLAG = 0;
-    pData->procStatus = PROC_STATUS_NOT_ONGOING;
-    pData->codecStatus = CODEC_STATUS_NOT_INITIALISED;
+    atomic_init(&pData->codecStatus, CODEC_STATUS_NOT_INITIALISED);
+    atomic_init(&pData->dirtyStages, STAGE_ALL);
 
     /* Init codec with defaults */
     hades_renderer_initCodec(*phHdR);
@@ -99,25 +204,33 @@ void hades_renderer_destroy
 )
 {
     hades_renderer_data *pData = (hades_renderer_data*)(*phHdR);
+    hades_codec_generation* gen;
 
     if (pData != NULL) {
-        /* not safe to free memory during intialisation/processing loop */
-        while (pData->codecStatus == CODEC_STATUS_INITIALISING ||
-               pData->procStatus == PROC_STATUS_ONGOING){
-            SAF_SLEEP(10);
-        }
-        free(pData->binConfig.hrirs);
-        free(pData->binConfig.hrir_dirs_deg);
-        hades_analysis_destroy(&(pData->hAna));
-        hades_param_container_destroy(&(pData->hPCon));
-        hades_signal_container_destroy(&(pData->hSCon));
-        hades_synthesis_destroy(&(pData->hSyn));
-        hades_radial_editor_destroy(&(pData->hREd));
+        /* not safe to free memory during intialisation */
+        hades_renderer_stopInitService(*phHdR);
+        hades_renderer_waitWhileInitialising(*phHdR);
+        hades_ir_registry_replace(&pData->mairSet, NULL);
+        hades_ir_registry_replace(&pData->hrirSet, NULL);
+        free(pData->cacheDirectory);
+        hades_mutex_destroy(&pData->pathLock);
+        gen = atomic_exchange(&pData->codecGen, NULL);
+        hades_renderer_retireCodecGeneration(*phHdR, &gen); /* (also waits for the processing loop to end) */
+        hades_mutex_destroy(&pData->ctrlLock);
+        hades_mutex_destroy(&pData->retireLock);
         free(pData->progressBarText);
-        free(pData->inputFrameTD);
-        free(pData->outputFrameTD);
+        free(pData->inFIFO);
+        free(pData->outFIFO);
+        free(pData->fadeFrameTD);
+        free(pData->newFrameTD);
+        free(pData->pipeInFrameTD);
+        free(pData->zeroFrame);
+        free(pData->discardFrameTD);
         free(pData->freqVector_local);
         free(pData->streamBalBands_local);
+        hades_waitable_destroy(&pData->statusChanged);
+        hades_post_service_release();
+        hades_mutex_destroy(&pData->profileLock);
 
         free(pData);
         pData = NULL;
@@ -132,17 +245,20 @@ void hades_renderer_init
 )
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation* gen;
 
     if(sampleRate!=(int)pData->fs){
         pData->fs = (float)sampleRate;
-        hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+        hades_renderer_markDirty(hHdR, STAGE_ALL);
     }
 
     /* reset (flush internal buffers with zeros etc.) */
-    if(pData->codecStatus == CODEC_STATUS_INITIALISED){
-        hades_analysis_reset(pData->hAna);
-        hades_synthesis_reset(pData->hSyn); 
+    gen = hades_renderer_acquireControlGeneration(hHdR);
+    if(atomic_load_explicit(&pData->codecStatus, memory_order_acquire) == CODEC_STATUS_INITIALISED && gen!=NULL){
+        hades_analysis_reset(gen->hAna);
+        hades_synthesis_reset(gen->hSyn); 
     }
+    hades_renderer_releaseControlGeneration(hHdR);
 }
 
 void hades_renderer_initCodec
@@ -151,43 +267,52 @@ void hades_renderer_initCodec
 )
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    int load_prevFLAG, nBands;
-    float* eq, *streamBalance, *tmp;
+    int nBands, frameSize, dirty, loaded, cancelled;
+    float* tmp;
+    float avgCoeff;
+    char *mairPath, *hrirPath, *cacheDir;
+    hades_ir_reduction mairReduction;
+    size_t cacheSizeLimit;
+    hades_progress progress;
+    hades_phase_start initStart, phaseStart;
+    hades_renderer_init_phase_profile total;
+    hades_renderer_init_profile profile;
     SAF_SOFA_ERROR_CODES error;
-    saf_sofa_container sofa;
-    float* grid_dirs_deg;
+    hades_ir_set *mair, *hrir;
+    hades_codec_generation *newGen, *oldGen;
+    HADES_CODEC_STATUS expected;
     HADES_DOA_ESTIMATORS doaOpt;
     HADES_DIFFUSENESS_ESTIMATORS diffOpt;
     HADES_BEAMFORMER_TYPE beamOpt;
+    HADES_HRTF_INTERP_OPTIONS interpOpt;
 
-    if (pData->codecStatus != CODEC_STATUS_NOT_INITIALISED)
+    /* Claim the initialisation (the current codec generation keeps processing audio in the meantime) */
+    expected = CODEC_STATUS_NOT_INITIALISED;
+    if (!atomic_compare_exchange_strong_explicit(&pData->codecStatus, &expected, CODEC_STATUS_INITIALISING,
+                                                 memory_order_acq_rel, memory_order_acquire))
         return; /* re-init not required, or already happening */
-    while (pData->procStatus == PROC_STATUS_ONGOING){
-        /* re-init required, but we need to wait for the current processing loop to end */
-        pData->codecStatus = CODEC_STATUS_INITIALISING; /* indicate that we want to init */
-        SAF_SLEEP(10);
-    }
-    
+    atomic_store(&pData->cancelInit, 0); /* (settings changed from now on will cancel this initialisation) */
+    hades_waitable_notify(&pData->statusChanged);
+    memset(&profile, 0, sizeof(hades_renderer_init_profile));
+    hades_renderer_startPhase(&initStart);
+
     /* for progress bar */
-    pData->codecStatus = CODEC_STATUS_INITIALISING;
     strcpy(pData->progressBarText,"Intialising Codec");
-    pData->progressBar0_1 = 0.0f;
-
-    /* Local copy of internal settings (since they are overriden) */
-    if(pData->hAna!=NULL && pData->hSyn!=NULL){
-        load_prevFLAG = 1;
-        tmp = hades_synthesis_getEqPtr(pData->hSyn, &nBands);
-        eq = malloc1d(nBands*sizeof(float));
-        memcpy(eq, tmp, nBands*sizeof(float));
-        tmp = hades_synthesis_getStreamBalancePtr(pData->hSyn, NULL);
-        streamBalance = malloc1d(nBands*sizeof(float));
-        memcpy(streamBalance, tmp, nBands*sizeof(float));
-    }
-    else{
-        load_prevFLAG = 0;
-        eq = streamBalance = NULL;
-        nBands = -1;
-    }
+    atomic_store(&pData->progressBar0_1, 0.0f);
+
+    /* (copied, as the paths may be changed while initialising) */
+    mairPath = hades_renderer_copyPath(pData, &pData->sofa_filepath_MAIR);
+    hrirPath = hades_renderer_copyPath(pData, &pData->sofa_filepath_HRIR);
+    cacheDir = hades_renderer_copyPath(pData, &pData->cacheDirectory);
+    hades_mutex_lock(&pData->pathLock);
+    mairReduction = pData->mairReduction;
+    cacheSizeLimit = (size_t)pData->cacheSizeLimit_MB<<20;
+    hades_mutex_unlock(&pData->pathLock);
+
+    /* The averaging is applied once per frame, so the default coefficient is
+     * scaled to retain the same time constant for any frame size */
+    frameSize = pData->frameSize;
+    avgCoeff = powf(DEFAULT_AVERAGING_COEFF, (float)frameSize/(float)MAX_FRAME_SIZE);
 
     /* Parse hades renderer enums into hades api enums */
     switch(pData->doaOption){
@@ -204,17 +329,51 @@ void hades_renderer_initCodec
         case HADES_RENDERER_BEAMFORMER_FILTER_AND_SUM: beamOpt = HADES_BEAMFORMER_FILTER_AND_SUM; break;
         case HADES_RENDERER_BEAMFORMER_BMVDR: beamOpt = HADES_BEAMFORMER_BMVDR; break;
     }
+    switch(pData->interpOption){
+        default: /* fall through */
+        case HADES_RENDERER_HRTF_INTERP_NEAREST: interpOpt = HADES_HRTF_INTERP_NEAREST; break;
+        case HADES_RENDERER_HRTF_INTERP_TRIANGULAR: interpOpt = HADES_HRTF_INTERP_TRIANGULAR; break;
+    }
 
-    /* Load SOFA file */
-    error = saf_sofa_open(&sofa, pData->sofa_filepath_MAIR, SAF_SOFA_READER_OPTION_DEFAULT);
+    /* Determine which stages need to be rebuilt; the rest are shared with the current generation */
+    oldGen = atomic_load(&pData->codecGen);
+    dirty = atomic_exchange(&pData->dirtyStages, 0);
+    if(oldGen==NULL || pData->mairSet==NULL)
+        dirty = STAGE_ALL;
+    else if(oldGen->frameSize!=frameSize)
+        dirty |= STAGE_ANALYSIS; /* (the IR sets do not depend on the frame size, and so are kept) */
+    if(dirty & STAGE_MAIR_SET)
+        dirty |= STAGE_ANALYSIS;
+    if(dirty & STAGE_ANALYSIS)
+        dirty |= STAGE_CONTAINERS | STAGE_SYNTHESIS;
+    if(dirty & STAGE_HRIR_SET)
+        dirty |= STAGE_SYNTHESIS;
+
+    /* Load SOFA file (or share the copy already loaded by another instance). IR sets are loaded even if the settings
+     * change in the meantime, as they are shared and cached, and so are rarely wasted effort */
+    newGen = NULL;
+    error = SAF_SOFA_OK;
+    loaded = 0; /* (IR sets that have been replaced, and so need not be reloaded if this initialisation is cancelled) */
+    if(dirty & STAGE_MAIR_SET){
+        hades_renderer_beginStage(pData, &progress, dirty, STAGE_MAIR_SET, "Loading Array IRs");
+        hades_renderer_startPhase(&phaseStart);
+        error = hades_ir_registry_acquire(&mair, mairPath, cacheDir, cacheSizeLimit, pData->fs, &mairReduction, &progress);
+        if(error==SAF_SOFA_OK && mair->nCh>HADES_MAX_NUM_INPUTS){ /* (more channels than the processing buffers can hold) */
+            hades_ir_registry_replace(&mair, NULL);
+            error = SAF_SOFA_ERROR_DIMENSIONS_UNEXPECTED;
+        }
+        hades_ir_registry_replace(&pData->mairSet, error==SAF_SOFA_OK ? mair : NULL); /* (kept, for rebuilding the analysis) */
+        hades_progress_advance(&progress, progress.nTotal);
+        hades_renderer_endPhase(&phaseStart, &profile.phases[HADES_RENDERER_INIT_PHASE_MAIR_LOAD]);
+        loaded |= STAGE_MAIR_SET;
+    }
+    mair = pData->mairSet;
+    cancelled = 0;
     if(error==SAF_SOFA_OK){
-        pData->nDirs = sofa.nSources;
-        pData->nMics = sofa.nReceivers;
-        pData->IR_fs = sofa.DataSamplingRate;
-        pData->IRlength = sofa.DataLengthIR;
-        grid_dirs_deg = malloc1d(pData->nDirs*2*sizeof(float));
-        cblas_scopy(pData->nDirs, sofa.SourcePosition, 3, grid_dirs_deg, 2); /* azi */
-        cblas_scopy(pData->nDirs, &sofa.SourcePosition[1], 3, &grid_dirs_deg[1], 2); /* elev */
+        pData->nDirs = mair->nDirs;
+        pData->nMics = mair->nCh;
+        pData->IR_fs = mair->sourceFs; /* (the IRs themselves are at pData->fs) */
+        pData->IRlength = mair->IRlength;
 
         /* Default reference sensor indices (if not defined or not valid based on the number of sensors) */
         if(pData->refsensor_idx[0]<0             || pData->refsensor_idx[1]<0 ||
@@ -222,92 +381,254 @@ void hades_renderer_initCodec
             /* Assuming that the first nMics/2 sensors belong to the left device, and the rest to the right device */
             pData->refsensor_idx[0] = 0;
             pData->refsensor_idx[1] = (int)((float)pData->nMics/2.0f + 0.0001f);
+            dirty |= STAGE_SYNTHESIS;
         }
 
-        /* Analysis */
-        strcpy(pData->progressBarText,"Intialising Analysis");
-        pData->progressBar0_1 = 0.3f;
-        hades_analysis_destroy(&(pData->hAna));
-        hades_analysis_create(&(pData->hAna), pData->fs, HADES_USE_AFSTFT, HOP_SIZE, FRAME_SIZE, SAF_TRUE /*hybridmode*/,
-                              sofa.DataIR, grid_dirs_deg, pData->nDirs, pData->nMics, sofa.DataLengthIR,
-                              diffOpt, doaOpt);
-        *hades_analysis_getCovarianceAvagingCoeffPtr(pData->hAna) = 0.77f;
-        free(grid_dirs_deg);
+        /* New codec generation */
+        newGen = (hades_codec_generation*)malloc1d(sizeof(hades_codec_generation));
+        newGen->nMics = pData->nMics;
+        newGen->frameSize = frameSize;
+        newGen->id = ++(pData->genCounter);
+        atomic_init(&newGen->fadeFrom, NULL);
+        newGen->nFadeFrames = newGen->nFadeWarmupFrames = 0;
+        atomic_init(&newGen->fadeFinished, 0);
+        newGen->hPool = NULL;
+        newGen->ana = NULL;
+        newGen->con = NULL;
+        newGen->syn = NULL;
+        if(pData->enablePipelining || pData->crossfadeFrames>0) /* (at most two jobs per batch, one run by the caller) */
+            hades_worker_pool_create(&(newGen->hPool), 1);
+
+        /* Analysis (and parameter radial editor) */
+        cancelled = hades_renderer_isInitCancelled(hHdR);
+        if(!cancelled){
+            if(dirty & STAGE_ANALYSIS){
+                hades_renderer_beginStage(pData, &progress, dirty, STAGE_ANALYSIS, "Intialising Analysis");
+                hades_renderer_startPhase(&phaseStart);
+                newGen->ana = (hades_analysis_stage*)malloc1d(sizeof(hades_analysis_stage));
+                atomic_init(&newGen->ana->refCount, 1);
+                /* (the tables derived from the IRs are built here for every instance, as the analysis object also holds
+                 * the filterbank/averaging states of this instance's stream; only the IRs themselves are shared) */
+                hades_analysis_create(&(newGen->ana->hAna), pData->fs, HADES_USE_AFSTFT, HOP_SIZE, frameSize, SAF_TRUE /*hybridmode*/,
+                                      mair->IRs, mair->dirs_deg, pData->nDirs, pData->nMics, mair->IRlength,
+                                      diffOpt, doaOpt);
+                *hades_analysis_getCovarianceAvagingCoeffPtr(newGen->ana->hAna) = avgCoeff;
+                hades_renderer_endPhase(&phaseStart, &profile.phases[HADES_RENDERER_INIT_PHASE_ANALYSIS]);
+                hades_renderer_startPhase(&phaseStart);
+                hades_radial_editor_create(&(newGen->ana->hREd), newGen->ana->hAna);
+                hades_renderer_endPhase(&phaseStart, &profile.phases[HADES_RENDERER_INIT_PHASE_RADIAL_EDITOR]);
+                hades_progress_advance(&progress, 1);
+            }
+            else{
+                newGen->ana = oldGen->ana;
+                atomic_fetch_add(&newGen->ana->refCount, 1);
+            }
+            newGen->hAna = newGen->ana->hAna;
+            newGen->hREd = newGen->ana->hREd;
+        }
 
         /* Parameter/signal containers */
-        strcpy(pData->progressBarText,"Intialising Containers");
-        pData->progressBar0_1 = 0.5f;
-        hades_param_container_destroy(&(pData->hPCon));
-        hades_param_container_create(&(pData->hPCon), pData->hAna);
-        hades_signal_container_destroy(&(pData->hSCon));
-        hades_signal_container_create(&(pData->hSCon), pData->hAna);
-
-        /* Synthesis */
-        strcpy(pData->progressBarText,"Intialising Synthesis");
-        pData->progressBar0_1 = 0.8f;
-        saf_sofa_close(&sofa); /* Close previous */
-        error = saf_sofa_open(&sofa, pData->sofa_filepath_HRIR, SAF_SOFA_READER_OPTION_DEFAULT);
-        if(error==SAF_SOFA_OK){
-            pData->binConfig.nHRIR = sofa.nSources;
-            pData->binConfig.hrir_fs = sofa.DataSamplingRate;
-            pData->binConfig.lHRIR = sofa.DataLengthIR;
-            pData->binConfig.hrir_dirs_deg = realloc1d(pData->binConfig.hrir_dirs_deg, pData->binConfig.nHRIR*2*sizeof(float));
-            cblas_scopy(pData->binConfig.nHRIR, sofa.SourcePosition, 3, pData->binConfig.hrir_dirs_deg, 2); /* azi */
-            cblas_scopy(pData->binConfig.nHRIR, &sofa.SourcePosition[1], 3, &pData->binConfig.hrir_dirs_deg[1], 2); /* elev */
-            pData->binConfig.hrirs = realloc1d(pData->binConfig.hrirs, pData->binConfig.nHRIR*NUM_EARS*pData->binConfig.lHRIR*sizeof(float));
-            cblas_scopy(pData->binConfig.nHRIR*NUM_EARS*pData->binConfig.lHRIR, sofa.DataIR, 1, pData->binConfig.hrirs, 1);
+        cancelled = cancelled || hades_renderer_isInitCancelled(hHdR);
+        if(!cancelled){
+            if(dirty & STAGE_CONTAINERS){
+                hades_renderer_beginStage(pData, &progress, dirty, STAGE_CONTAINERS, "Intialising Containers");
+                hades_renderer_startPhase(&phaseStart);
+                newGen->con = (hades_container_stage*)malloc1d(sizeof(hades_container_stage));
+                atomic_init(&newGen->con->refCount, 1);
+                hades_param_container_create(&(newGen->con->hPCon), newGen->hAna);
+                hades_signal_container_create(&(newGen->con->hSCon), newGen->hAna);
+                newGen->con->pipelined = pData->enablePipelining;
+                newGen->con->hPConPipe = NULL;
+                newGen->con->hSConPipe = NULL;
+                if(newGen->con->pipelined){
+                    /* A second set, so that one frame can be analysed while the previous one is synthesised */
+                    hades_param_container_create(&(newGen->con->hPConPipe), newGen->hAna);
+                    hades_signal_container_create(&(newGen->con->hSConPipe), newGen->hAna);
+                }
+                hades_renderer_endPhase(&phaseStart, &profile.phases[HADES_RENDERER_INIT_PHASE_CONTAINERS]);
+                hades_progress_advance(&progress, 1);
+            }
+            else{
+                newGen->con = oldGen->con;
+                atomic_fetch_add(&newGen->con->refCount, 1);
+            }
         }
-        else{ /* Load default HRIRs: */
-            pData->binConfig.hrirs = realloc1d(pData->binConfig.hrirs, __default_N_hrir_dirs*NUM_EARS*__default_hrir_len*sizeof(float));
-            cblas_scopy(__default_N_hrir_dirs*NUM_EARS*__default_hrir_len, (float*)__default_hrirs, 1, pData->binConfig.hrirs, 1);
-            pData->binConfig.hrir_dirs_deg = realloc1d(pData->binConfig.hrir_dirs_deg, __default_N_hrir_dirs*2*sizeof(float));
-            cblas_scopy(__default_N_hrir_dirs*2, (float*)__default_hrir_dirs_deg, 1, pData->binConfig.hrir_dirs_deg, 1);
-            pData->binConfig.nHRIR = __default_N_hrir_dirs;
-            pData->binConfig.lHRIR = __default_hrir_len;
-            pData->binConfig.hrir_fs = __default_hrir_fs;
-            pData->useDefaultHRIRsFLAG = 1;
+
+        /* HRIRs */
+        cancelled = cancelled || hades_renderer_isInitCancelled(hHdR);
+        if(!cancelled && (dirty & STAGE_HRIR_SET)){
+            /* (binConfig only holds views of the HRIR data, which is never modified) */
+            hades_renderer_beginStage(pData, &progress, dirty, STAGE_HRIR_SET, "Loading HRIRs");
+            hades_renderer_startPhase(&phaseStart);
+            error = hades_ir_registry_acquire(&hrir, hrirPath, cacheDir, cacheSizeLimit, pData->fs, NULL, &progress);
+            if(error!=SAF_SOFA_OK){ /* Use default HRIRs: */
+                hades_ir_registry_acquireDefaultHRIRs(&hrir, pData->fs, &progress);
+                pData->useDefaultHRIRsFLAG = 1;
+            }
+            pData->binConfig.nHRIR = hrir->nDirs;
+            pData->binConfig.hrir_fs = (int)(hrir->IR_fs+0.5f);
+            pData->binConfig.lHRIR = hrir->IRlength;
+            pData->binConfig.hrir_dirs_deg = hrir->dirs_deg;
+            pData->binConfig.hrirs = hrir->IRs;
+            pData->HRIR_fs = hrir->sourceFs;
+            hades_ir_registry_replace(&pData->hrirSet, hrir); /* (the previous synthesis has its own copy of the old set) */
+            hades_progress_advance(&progress, progress.nTotal);
+            hades_renderer_endPhase(&phaseStart, &profile.phases[HADES_RENDERER_INIT_PHASE_HRIR_LOAD]);
+            loaded |= STAGE_HRIR_SET;
         }
-        hades_synthesis_destroy(&(pData->hSyn));
-        hades_synthesis_create(&(pData->hSyn), pData->hAna, beamOpt, pData->enableCovMatching, pData->refsensor_idx, &pData->binConfig, HADES_HRTF_INTERP_NEAREST);
-        *hades_synthesis_getSynthesisAveragingCoeffPtr(pData->hSyn) = 0.77f;
 
-        /* Parameter radial editor */
-        hades_radial_editor_destroy(&(pData->hREd));
-        hades_radial_editor_create(&(pData->hREd), pData->hAna);
+        /* Synthesis */
+        cancelled = cancelled || hades_renderer_isInitCancelled(hHdR);
+        if(!cancelled){
+            if(dirty & STAGE_SYNTHESIS){
+                hades_renderer_beginStage(pData, &progress, dirty, STAGE_SYNTHESIS, "Intialising Synthesis");
+                hades_renderer_startPhase(&phaseStart);
+                newGen->syn = (hades_synthesis_stage*)malloc1d(sizeof(hades_synthesis_stage));
+                atomic_init(&newGen->syn->refCount, 1);
+                hades_synthesis_create(&(newGen->syn->hSyn), newGen->hAna, beamOpt, pData->enableCovMatching, pData->refsensor_idx, &pData->binConfig, interpOpt);
+                *hades_synthesis_getSynthesisAveragingCoeffPtr(newGen->syn->hSyn) = avgCoeff;
+                hades_renderer_endPhase(&phaseStart, &profile.phases[HADES_RENDERER_INIT_PHASE_SYNTHESIS]);
+                hades_progress_advance(&progress, 1);
+            }
+            else{
+                newGen->syn = oldGen->syn;
+                atomic_fetch_add(&newGen->syn->refCount, 1);
+            }
+            newGen->hSyn = newGen->syn->hSyn;
+        }
 
         /* All went OK */
         pData->MAIR_SOFA_isLoadedFLAG = 1;
     }
     else /* Bypass audio, try to load a valid SOFA file instead: */
         pData->MAIR_SOFA_isLoadedFLAG = 0;
-    saf_sofa_close(&sofa);
+    free(mairPath);
+    free(hrirPath);
+    free(cacheDir);
+
+    /* If the settings have changed in the meantime, then the new generation is abandoned (the current one keeps running),
+     * and whatever it was to rebuild is left for the next initialisation, which is requested straight away */
+    cancelled = cancelled || hades_renderer_isInitCancelled(hHdR);
+    if(cancelled){
+        hades_codec_generation_discard(&newGen);
+        atomic_fetch_or(&pData->dirtyStages, dirty & ~loaded);
+        strcpy(pData->progressBarText,"Restarting");
+        hades_mutex_lock(&pData->profileLock);
+        pData->initProfile.nCancelled++;
+        hades_mutex_unlock(&pData->profileLock);
+        atomic_store(&pData->codecStatus, CODEC_STATUS_NOT_INITIALISED);
+        hades_waitable_notify(&pData->statusChanged);
+        if(pData->initService!=NULL)
+            hades_init_service_request(pData->initService);
+        return;
+    }
+
+    /* Carry over the previous internal settings (if not first init, the synthesis was rebuilt, and nBands is the same).
+     * The get/set functions are held off meanwhile, as they may be changing these settings */
+    hades_renderer_startPhase(&phaseStart);
+    hades_mutex_lock(&pData->ctrlLock);
+    if(newGen!=NULL && oldGen!=NULL && newGen->syn!=oldGen->syn &&
+       hades_analysis_getNbands(oldGen->hAna)==hades_analysis_getNbands(newGen->hAna)){
+        tmp = hades_synthesis_getEqPtr(oldGen->hSyn, &nBands);
+        memcpy(hades_synthesis_getEqPtr(newGen->hSyn, NULL), tmp, nBands*sizeof(float));
+        tmp = hades_synthesis_getStreamBalancePtr(oldGen->hSyn, NULL);
+        memcpy(hades_synthesis_getStreamBalancePtr(newGen->hSyn, NULL), tmp, nBands*sizeof(float));
+    }
+    hades_mutex_unlock(&pData->ctrlLock);
+
+    /* Optionally, keep the old generation running alongside the new one, so that the processing loop can crossfade between
+     * them (only if the output is affected, i.e. the synthesis was rebuilt) */
+    if(newGen!=NULL && oldGen!=NULL && pData->crossfadeFrames>0 && newGen->syn!=oldGen->syn &&
+       oldGen->nMics==newGen->nMics && oldGen->frameSize==newGen->frameSize &&
+       oldGen->con->pipelined==newGen->con->pipelined){
+        /* (the old output is kept until the new filterbanks have filled, and then faded out; if the analysis is
+         * shared, then only the synthesis filterbank needs to fill) */
+        newGen->nFadeWarmupFrames = newGen->ana==oldGen->ana && newGen->con==oldGen->con ? hades_synthesis_getProcDelay(newGen->hSyn) :
+                                                               hades_codec_generation_getDelay(newGen);
+        newGen->nFadeWarmupFrames = (newGen->nFadeWarmupFrames+frameSize-1)/frameSize;
+        newGen->nFadeFrames = newGen->nFadeWarmupFrames + pData->crossfadeFrames;
+        atomic_store(&newGen->fadeFrom, oldGen);
+    }
 
-    /* Load previous internal settings (if not first init, and nBands is the same) */
-    if(load_prevFLAG && (nBands==hades_analysis_getNbands(pData->hAna))){
-        tmp = hades_synthesis_getEqPtr(pData->hSyn, &nBands);
-        memcpy(tmp, eq, nBands*sizeof(float));
-        tmp = hades_synthesis_getStreamBalancePtr(pData->hSyn, NULL);
-        memcpy(tmp, streamBalance, nBands*sizeof(float));
+    /* Publish the new generation (picked up by the next processing loop) */
+    hades_mutex_lock(&pData->retireLock);
+    oldGen = atomic_exchange(&pData->codecGen, newGen);
+    if(newGen!=NULL && atomic_load(&newGen->fadeFrom)==oldGen && oldGen!=NULL){
+        /* The old generation is now owned by the new one; only whatever it was still fading from can go. The old
+         * generation itself is destroyed once the crossfade has finished, by the initialisation service (see
+         * hades_renderer_collectFadeSource()), or otherwise upon the next reinitialisation */
+        hades_renderer_releaseFadeSource(hHdR, oldGen, -1);
     }
- 
+    else /* Destroy the old generation once it is no longer in use */
+        hades_renderer_retireCodecGeneration(hHdR, &oldGen);
+    hades_mutex_unlock(&pData->retireLock);
+
     /* Local copy of internal parameter vectors (for optional thread-safe GUI plotting) */
-    if(!load_prevFLAG || (hades_analysis_getNbands(pData->hAna)!=pData->nBands_local)){
-        /* If first init... Or nBands has changed */
-        pData->nBands_local = hades_analysis_getNbands(pData->hAna);
-        pData->freqVector_local = realloc1d(pData->freqVector_local, pData->nBands_local*sizeof(float));
-        pData->streamBalBands_local = realloc1d(pData->streamBalBands_local, pData->nBands_local*sizeof(float));
+    hades_mutex_lock(&pData->ctrlLock);
+    if(newGen!=NULL){
+        if(hades_analysis_getNbands(newGen->hAna)!=pData->nBands_local){
+            /* If first init... Or nBands has changed */
+            pData->nBands_local = hades_analysis_getNbands(newGen->hAna);
+            pData->freqVector_local = realloc1d(pData->freqVector_local, pData->nBands_local*sizeof(float));
+            pData->streamBalBands_local = realloc1d(pData->streamBalBands_local, pData->nBands_local*sizeof(float));
+        }
+        tmp = (float*)hades_analysis_getFrequencyVectorPtr(newGen->hAna, NULL);
+        memcpy(pData->freqVector_local, tmp, pData->nBands_local*sizeof(float));
+        tmp = hades_synthesis_getStreamBalancePtr(newGen->hSyn, NULL);
+        memcpy(pData->streamBalBands_local, tmp, pData->nBands_local*sizeof(float));
     }
-    tmp = (float*)hades_analysis_getFrequencyVectorPtr(pData->hAna, NULL);
-    memcpy(pData->freqVector_local, tmp, pData->nBands_local*sizeof(float));
-    tmp = hades_synthesis_getStreamBalancePtr(pData->hSyn, NULL);
-    memcpy(pData->streamBalBands_local, tmp, pData->nBands_local*sizeof(float));
+    hades_mutex_unlock(&pData->ctrlLock);
+
+    hades_renderer_endPhase(&phaseStart, &profile.phases[HADES_RENDERER_INIT_PHASE_PUBLISH]);
+
+    /* Profile (the counts carry on from the previous one) */
+    hades_renderer_endPhase(&initStart, &total);
+    profile.wallTime_ms = total.wallTime_ms;
+    profile.cpuTime_ms = total.cpuTime_ms;
+    profile.peakMemoryIncrease = total.peakMemoryIncrease;
+    hades_mutex_lock(&pData->profileLock);
+    profile.nInits = pData->initProfile.nInits + 1;
+    profile.nCancelled = pData->initProfile.nCancelled;
+    pData->initProfile = profile;
+    hades_mutex_unlock(&pData->profileLock);
 
     /* done! */
     strcpy(pData->progressBarText,"Done!");
-    pData->progressBar0_1 = 1.0f;
-    pData->codecStatus = CODEC_STATUS_INITIALISED;
-    free(eq);
-    free(streamBalance);
+    atomic_store(&pData->progressBar0_1, 1.0f);
+    atomic_store(&pData->codecStatus, CODEC_STATUS_INITIALISED);
+
+    /* Settings changed after the last check are picked up by another initialisation (see hades_renderer_markDirty()) */
+    if(atomic_load(&pData->cancelInit)){
+        expected = CODEC_STATUS_INITIALISED;
+        atomic_compare_exchange_strong(&pData->codecStatus, &expected, CODEC_STATUS_NOT_INITIALISED);
+        if(pData->initService!=NULL)
+            hades_init_service_request(pData->initService);
+    }
+    hades_waitable_notify(&pData->statusChanged);
+}
+
+int hades_renderer_startInitService
+(
+    void* const hHdR
+)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    if(pData->initService==NULL)
+        hades_init_service_create(&pData->initService, hHdR);
+    return pData->initService!=NULL;
+}
+
+void hades_renderer_stopInitService
+(
+    void* const hHdR
+)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    if(pData->initService!=NULL){
+        /* (an initialisation that the service is running stops at its next stage boundary, and is then waited for) */
+        atomic_store(&pData->cancelInit, 1);
+        hades_init_service_destroy(&pData->initService);
+    }
 }
 
 void hades_renderer_process
@@ -321,48 +642,101 @@ void hades_renderer_process
 )
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    int ch, nMics;
-
-    /* Local copies of parameters */
-    nMics = pData->nMics;
-    
-    /* Process Frame if everything is ready */
-    if ((nSamples == FRAME_SIZE) && (pData->codecStatus == CODEC_STATUS_INITIALISED) && pData->MAIR_SOFA_isLoadedFLAG) {
-        pData->procStatus = PROC_STATUS_ONGOING;
-
-        /* Load time-domain data */
-        for(ch=0; ch < SAF_MIN(nMics, nInputs); ch++)
-            utility_svvcopy(inputs[ch], FRAME_SIZE, pData->inputFrameTD[ch]);
-        for(; ch<nMics; ch++)
-            memset(pData->inputFrameTD[ch], 0, FRAME_SIZE * sizeof(float)); /* fill remaining channels with zeros */
+    hades_codec_generation *gen;
+    int s, ch, nMics, nCopy, frameSize;
 
-        /* Apply hades analysis */
-        hades_analysis_apply(pData->hAna, pData->inputFrameTD, nMics, FRAME_SIZE, pData->hPCon, pData->hSCon);
+    /* Flag the current codec generation as in use, so that it is not destroyed during processing */
+    gen = hades_renderer_acquireCodecGeneration(hHdR);
 
-        /* Apply the hades parameter radial editor */
-        hades_radial_editor_apply(pData->hREd, pData->hPCon, pData->dirGain_dB);
+    /* Local copies of parameters */
+    nMics = gen==NULL ? 0 : gen->nMics;
+    frameSize = gen==NULL ? pData->frameSize : gen->frameSize;
+    if(pData->FIFO_idx >= frameSize)
+        pData->FIFO_idx = 0; /* frame size was reduced since the last call */
+
+    /* Loop over the host block, in chunks that fit in the remaining FIFO space */
+    for(s=0; s<nSamples; s+=nCopy){
+        nCopy = SAF_MIN(nSamples-s, frameSize-pData->FIFO_idx);
+
+        /* Load input signals into inFIFO buffer (all inputs are read before any
+         * outputs are written, so inputs and outputs may share the same buffers) */
+        for(ch=0; ch<SAF_MIN(SAF_MIN(nInputs, nMics), HADES_MAX_NUM_INPUTS); ch++)
+            utility_svvcopy(&inputs[ch][s], nCopy, &pData->inFIFO[ch][pData->FIFO_idx]);
+        for(; ch<SAF_MIN(nMics, HADES_MAX_NUM_INPUTS); ch++) /* Zero any channels that were not given */
+            memset(&pData->inFIFO[ch][pData->FIFO_idx], 0, nCopy*sizeof(float));
+
+        /* Pull output signals from outFIFO buffer */
+        for(ch=0; ch<SAF_MIN(nOutputs, NUM_EARS); ch++)
+            memcpy(&outputs[ch][s], &pData->outFIFO[ch][pData->FIFO_idx], nCopy*sizeof(float));
+        for(; ch<nOutputs; ch++) /* Zero any extra channels */
+            memset(&outputs[ch][s], 0, nCopy*sizeof(float));
+
+        /* Increment buffer index */
+        pData->FIFO_idx += nCopy;
+
+        /* Process frame if inFIFO is full and codec is ready for it */
+        if (pData->FIFO_idx >= frameSize && gen != NULL) {
+            pData->FIFO_idx = 0;
+
+            /* Apply hades analysis, radial editor, and synthesis */
+            hades_renderer_processCodecFrame(hHdR, gen, pData->inFIFO, pData->outFIFO);
+        }
+        else if(pData->FIFO_idx >= frameSize){
+            /* clear outFIFO if codec was not ready */
+            pData->FIFO_idx = 0;
+            memset(FLATTEN2D(pData->outFIFO), 0, NUM_EARS*MAX_FRAME_SIZE*sizeof(float));
+        }
+    }
 
-        /* Apply hades synthesis */
-        hades_synthesis_apply(pData->hSyn, pData->hPCon, pData->hSCon, NUM_EARS, FRAME_SIZE, pData->outputFrameTD);
+    hades_renderer_releaseCodecGeneration(hHdR);
+}
 
-        /* Copy to output */
-        for(ch=0; ch<SAF_MIN(NUM_EARS,nOutputs); ch++)
-            memcpy(outputs[ch], pData->outputFrameTD[ch], FRAME_SIZE*sizeof(float));
+void hades_renderer_processFrame
+(
+    void        *  const hHdR,
+    const float *const * inputs,
+    float* const* const  outputs,
+    int                  nInputs,
+    int                  nOutputs,
+    int                  nSamples
+)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation *gen;
+    float* inFrame[HADES_MAX_NUM_INPUTS];
+    float* outFrame[NUM_EARS];
+    int ch;
+
+    gen = hades_renderer_acquireCodecGeneration(hHdR);
+
+    if(gen!=NULL && nSamples==gen->frameSize){
+        /* Point directly to the host buffers (missing inputs are read as zeros,
+         * and missing outputs are rendered into a scratch buffer) */
+        for(ch=0; ch<SAF_MIN(gen->nMics, HADES_MAX_NUM_INPUTS); ch++)
+            inFrame[ch] = ch<nInputs ? (float*)inputs[ch] : pData->zeroFrame;
+        for(ch=0; ch<NUM_EARS; ch++)
+            outFrame[ch] = ch<nOutputs ? outputs[ch] : pData->discardFrameTD[ch];
+
+        /* Apply hades analysis, radial editor, and synthesis (the analysis has
+         * consumed all inputs before the synthesis writes to the outputs) */
+        hades_renderer_processCodecFrame(hHdR, gen, inFrame, outFrame);
+        for(ch=NUM_EARS; ch<nOutputs; ch++) /* Zero any extra channels */
+            memset(outputs[ch], 0, nSamples*sizeof(float));
     }
     else{
-        /* output zero if one of the pre-requrisite conditions are not met */
+        /* Codec not ready, or wrong number of samples */
         for(ch=0; ch<nOutputs; ch++)
-            memset(outputs[ch], 0, FRAME_SIZE*sizeof(float));
+            memset(outputs[ch], 0, nSamples*sizeof(float));
     }
 
-    pData->procStatus = PROC_STATUS_NOT_ONGOING;
+    hades_renderer_releaseCodecGeneration(hHdR);
 }
     
 /* Set Functions */
     
 void hades_renderer_refreshSettings(void* const hHdR)
 {
-    hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+    hades_renderer_markDirty(hHdR, STAGE_ALL);
 }
 
 void hades_renderer_setDoAestimator(void* const hHdR, HADES_RENDERER_DOA_ESTIMATORS newEstimator)
@@ -370,7 +744,7 @@ void hades_renderer_setDoAestimator(void* const hHdR, HADES_RENDERER_DOA_ESTIMAT
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
     if(newEstimator!=pData->doaOption){
         pData->doaOption = newEstimator;
-        hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+        hades_renderer_markDirty(hHdR, STAGE_ANALYSIS);
     }
 }
 
@@ -379,7 +753,7 @@ void hades_renderer_setDiffusenessEstimator(void* const hHdR, HADES_RENDERER_DIF
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
     if(newEstimator!=pData->diffOption){
         pData->diffOption = newEstimator;
-        hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+        hades_renderer_markDirty(hHdR, STAGE_ANALYSIS);
     }
 }
 
@@ -388,7 +762,16 @@ void hades_renderer_setBeamformer(void* const hHdR, HADES_RENDERER_BEAMFORMER_TY
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
     if(newType!=pData->beamOption){
         pData->beamOption = newType;
-        hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+        hades_renderer_markDirty(hHdR, STAGE_SYNTHESIS);
+    }
+}
+
+void hades_renderer_setHRTFinterpMode(void* const hHdR, HADES_RENDERER_HRTF_INTERP_OPTIONS newMode)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    if(newMode!=pData->interpOption){
+        pData->interpOption = newMode;
+        hades_renderer_markDirty(hHdR, STAGE_SYNTHESIS);
     }
 }
 
@@ -397,24 +780,56 @@ void hades_renderer_setEnableCovMatching(void* const hHdR, int newState)
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
     if(newState!=pData->enableCovMatching){
         pData->enableCovMatching = newState;
-        hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+        hades_renderer_markDirty(hHdR, STAGE_SYNTHESIS);
     }
 }
 
-void hades_renderer_setAnalysisAveraging(void* const hHdR, float newValue)
+void hades_renderer_setFrameSize(void* const hHdR, int newFrameSize)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    if(pData->hAna==NULL)
-        return;
-    *hades_analysis_getCovarianceAvagingCoeffPtr(pData->hAna) = newValue;
+    /* Round down to the nearest multiple of the hop size, within the supported range */
+    newFrameSize = SAF_CLAMP((newFrameSize/HOP_SIZE)*HOP_SIZE, HOP_SIZE, MAX_FRAME_SIZE);
+    if(newFrameSize!=pData->frameSize){
+        pData->frameSize = newFrameSize;
+        hades_renderer_markDirty(hHdR, STAGE_ANALYSIS);
+    }
 }
 
-void hades_renderer_setSynthesisAveraging(void* const hHdR, float newValue)
+void hades_renderer_setCrossfadeLength(void* const hHdR, int nFrames)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    if(pData->hSyn==NULL)
-        return;
-    *hades_synthesis_getSynthesisAveragingCoeffPtr(pData->hSyn) = newValue;
+    pData->crossfadeFrames = SAF_CLAMP(nFrames, 0, HADES_MAX_CROSSFADE_FRAMES);
+}
+
+void hades_renderer_setEnableSilenceGate(void* const hHdR, int newState)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    pData->enableSilenceGate = newState;
+}
+
+void hades_renderer_setEnablePipelining(void* const hHdR, int newState)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    if(newState!=pData->enablePipelining){
+        pData->enablePipelining = newState;
+        hades_renderer_markDirty(hHdR, STAGE_CONTAINERS);
+    }
+}
+
+void hades_renderer_setAnalysisAveraging(void* const hHdR, float newValue)
+{
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
+    if(gen!=NULL)
+        *hades_analysis_getCovarianceAvagingCoeffPtr(gen->hAna) = newValue;
+    hades_renderer_releaseControlGeneration(hHdR);
+}
+
+void hades_renderer_setSynthesisAveraging(void* const hHdR, float newValue)
+{
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
+    if(gen!=NULL)
+        *hades_synthesis_getSynthesisAveragingCoeffPtr(gen->hSyn) = newValue;
+    hades_renderer_releaseControlGeneration(hHdR);
 }
 
 void hades_renderer_setReferenceSensorIndex(void* const hHdR, int leftOrRight, int newIndex)
@@ -426,50 +841,58 @@ void hades_renderer_setReferenceSensorIndex(void* const hHdR, int leftOrRight, i
     saf_assert(newIndex < pData->nMics, "Index must not exceed the number of mics");
     if(newIndex!=pData->refsensor_idx[leftOrRight]){
         pData->refsensor_idx[leftOrRight] = newIndex;
-        hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+        hades_renderer_markDirty(hHdR, STAGE_SYNTHESIS);
     }
 }
 
 void hades_renderer_setStreamBalanceFromLocal(void* const hHdR)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
     int nBands;
     float* streamBalance;
-    streamBalance = hades_synthesis_getStreamBalancePtr(pData->hSyn, &nBands);
+    streamBalance = hades_synthesis_getStreamBalancePtr(gen==NULL ? NULL : gen->hSyn, &nBands);
     if(nBands==pData->nBands_local && streamBalance != NULL && pData->streamBalBands_local != NULL)
         memcpy(streamBalance, pData->streamBalBands_local, nBands*sizeof(float));
+    hades_renderer_releaseControlGeneration(hHdR);
 }
 
 void hades_renderer_setStreamBalance(void * const hHdR, float newValue, int bandIdx)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
     int nBands;
     float* streamBalance;
-    streamBalance = hades_synthesis_getStreamBalancePtr(pData->hSyn, &nBands);
-    if(bandIdx>=nBands-1 || streamBalance == NULL)
-        return;
-    streamBalance[bandIdx] = newValue;
-    pData->streamBalBands_local[bandIdx] = newValue;
+    streamBalance = hades_synthesis_getStreamBalancePtr(gen==NULL ? NULL : gen->hSyn, &nBands);
+    if(bandIdx<nBands-1 && streamBalance != NULL){
+        streamBalance[bandIdx] = newValue;
+        pData->streamBalBands_local[bandIdx] = newValue;
+    }
+    hades_renderer_releaseControlGeneration(hHdR);
 }
 
 void hades_renderer_setStreamBalanceAllBands(void * const hHdR, float newValue)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
     int nBands, band;
     float* streamBalance;
-    streamBalance = hades_synthesis_getStreamBalancePtr(pData->hSyn, &nBands);
+    streamBalance = hades_synthesis_getStreamBalancePtr(gen==NULL ? NULL : gen->hSyn, &nBands);
     for(band=0; band<nBands; band++){ /* nBands==0 when streamBalance==NULL */
         streamBalance[band] = newValue;
         pData->streamBalBands_local[band] = newValue;
     }
+    hades_renderer_releaseControlGeneration(hHdR);
 }
 
 void hades_renderer_setSofaFilePathMAIR(void* const hHdR, const char* path)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_mutex_lock(&pData->pathLock);
     pData->sofa_filepath_MAIR = realloc1d(pData->sofa_filepath_MAIR, strlen(path) + 1);
     strcpy(pData->sofa_filepath_MAIR, path);
-    hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+    hades_mutex_unlock(&pData->pathLock);
+    hades_renderer_markDirty(hHdR, STAGE_MAIR_SET);
 }
 
 void hades_renderer_setUseDefaultHRIRsflag(void* const hHdR, int newState)
@@ -477,36 +900,142 @@ void hades_renderer_setUseDefaultHRIRsflag(void* const hHdR, int newState)
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
     if((!pData->useDefaultHRIRsFLAG) && (newState)){
         pData->useDefaultHRIRsFLAG = newState;
-        hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+        hades_renderer_markDirty(hHdR, STAGE_HRIR_SET);
     }
 }
 
 void hades_renderer_setSofaFilePathHRIR(void* const hHdR, const char* path)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_mutex_lock(&pData->pathLock);
     pData->sofa_filepath_HRIR = realloc1d(pData->sofa_filepath_HRIR, strlen(path) + 1);
     strcpy(pData->sofa_filepath_HRIR, path);
-    hades_renderer_setCodecStatus(hHdR, CODEC_STATUS_NOT_INITIALISED);
+    hades_mutex_unlock(&pData->pathLock);
+    hades_renderer_markDirty(hHdR, STAGE_HRIR_SET);
+}
+
+void hades_renderer_setCacheDirectory(void* const hHdR, const char* path)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    /* (no reinit required, the cache only affects how the next one loads) */
+    hades_mutex_lock(&pData->pathLock);
+    if(path==NULL || path[0]=='\0'){
+        free(pData->cacheDirectory);
+        pData->cacheDirectory = NULL;
+    }
+    else{
+        pData->cacheDirectory = realloc1d(pData->cacheDirectory, strlen(path) + 1);
+        strcpy(pData->cacheDirectory, path);
+    }
+    hades_mutex_unlock(&pData->pathLock);
+}
+
+void hades_renderer_setCacheSizeLimit(void* const hHdR, int limit_MB)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    /* (no reinit required, the limit is enforced whenever an entry is added) */
+    hades_mutex_lock(&pData->pathLock);
+    pData->cacheSizeLimit_MB = SAF_MAX(limit_MB, 0);
+    hades_mutex_unlock(&pData->pathLock);
+}
+
+void hades_renderer_setEnableIRtruncation(void* const hHdR, int newState)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    newState = newState ? 1 : 0;
+    if(newState!=pData->mairReduction.truncate){
+        hades_mutex_lock(&pData->pathLock);
+        pData->mairReduction.truncate = newState;
+        hades_mutex_unlock(&pData->pathLock);
+        hades_renderer_markDirty(hHdR, STAGE_MAIR_SET);
+    }
+}
+
+void hades_renderer_setTargetNDirsArray(void* const hHdR, int nDirs)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    nDirs = SAF_MAX(nDirs, 0);
+    if(nDirs!=pData->mairReduction.targetNumDirs){
+        hades_mutex_lock(&pData->pathLock);
+        pData->mairReduction.targetNumDirs = nDirs;
+        hades_mutex_unlock(&pData->pathLock);
+        hades_renderer_markDirty(hHdR, STAGE_MAIR_SET);
+    }
+}
+
+void hades_renderer_setMaxSteeringErrorArray(void* const hHdR, float newValue)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    newValue = SAF_CLAMP(newValue, -40.0f, 0.0f);
+    if(newValue!=pData->mairReduction.maxSteeringError_dB){
+        hades_mutex_lock(&pData->pathLock);
+        pData->mairReduction.maxSteeringError_dB = newValue;
+        hades_mutex_unlock(&pData->pathLock);
+        if(pData->mairReduction.targetNumDirs>0) /* (otherwise, there is no decimation for it to affect) */
+            hades_renderer_markDirty(hHdR, STAGE_MAIR_SET);
+    }
 }
 
 
 /* Get Functions */
 
-int hades_renderer_getFrameSize(void)
+int hades_renderer_getFrameSize(void* const hHdR)
 {
-    return FRAME_SIZE;
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->frameSize;
+}
+
+int hades_renderer_getHopSize(void)
+{
+    return HOP_SIZE;
+}
+
+int hades_renderer_getEnableSilenceGate(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->enableSilenceGate;
+}
+
+int hades_renderer_getEnablePipelining(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->enablePipelining;
+}
+
+int hades_renderer_getCrossfadeLength(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->crossfadeFrames;
+}
+
+int hades_renderer_getCrossfadeWindow(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation* gen;
+    int nWarmupFrames, window;
+    if(pData->crossfadeFrames==0)
+        return 0;
+    gen = hades_renderer_acquireControlGeneration(hHdR);
+    if(gen==NULL || gen->frameSize!=pData->frameSize)
+        window = (pData->crossfadeFrames+1)*pData->frameSize; /* (estimate, until the codec is initialised) */
+    else{
+        nWarmupFrames = (hades_codec_generation_getDelay(gen)+gen->frameSize-1)/gen->frameSize;
+        window = (nWarmupFrames+pData->crossfadeFrames)*gen->frameSize;
+    }
+    hades_renderer_releaseControlGeneration(hHdR);
+    return window;
 }
 
 HADES_CODEC_STATUS hades_renderer_getCodecStatus(void* const hHdR)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    return pData->codecStatus;
+    return atomic_load_explicit(&pData->codecStatus, memory_order_acquire);
 }
 
 float hades_renderer_getProgressBar0_1(void* const hHdR)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    return pData->progressBar0_1;
+    return atomic_load(&pData->progressBar0_1);
 }
 
 void hades_renderer_getProgressBarText(void* const hHdR, char* text)
@@ -533,6 +1062,12 @@ HADES_RENDERER_BEAMFORMER_TYPE hades_renderer_getBeamformer(void* const hHdR)
     return pData->beamOption;
 }
 
+HADES_RENDERER_HRTF_INTERP_OPTIONS hades_renderer_getHRTFinterpMode(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->interpOption;
+}
+
 int hades_renderer_getEnableCovMatching(void* const hHdR)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
@@ -541,14 +1076,18 @@ int hades_renderer_getEnableCovMatching(void* const hHdR)
 
 float hades_renderer_getAnalysisAveraging(void* const hHdR)
 {
-    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    return pData->hAna==NULL ? 0.5f : *hades_analysis_getCovarianceAvagingCoeffPtr(pData->hAna);
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
+    float value = gen==NULL ? 0.5f : *hades_analysis_getCovarianceAvagingCoeffPtr(gen->hAna);
+    hades_renderer_releaseControlGeneration(hHdR);
+    return value;
 }
 
 float hades_renderer_getSynthesisAveraging(void* const hHdR)
 {
-    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    return pData->hSyn==NULL ? 0.5f : *hades_synthesis_getSynthesisAveragingCoeffPtr(pData->hSyn);
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
+    float value = gen==NULL ? 0.5f : *hades_synthesis_getSynthesisAveragingCoeffPtr(gen->hSyn);
+    hades_renderer_releaseControlGeneration(hHdR);
+    return value;
 }
 
 int hades_renderer_getReferenceSensorIndex(void* const hHdR, int leftOrRight)
@@ -560,22 +1099,28 @@ int hades_renderer_getReferenceSensorIndex(void* const hHdR, int leftOrRight)
 
 float hades_renderer_getStreamBalance(void* const hHdR, int bandIdx)
 {
-    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
     int nBands;
+    float value;
     float* streamBalance;
-    streamBalance = hades_synthesis_getStreamBalancePtr(pData->hSyn, &nBands);
+    streamBalance = hades_synthesis_getStreamBalancePtr(gen==NULL ? NULL : gen->hSyn, &nBands);
     if(bandIdx>=nBands-1)
-        return 0.0f;
+        value = 0.0f;
     else
-        return streamBalance == NULL ? 0.0f : streamBalance[bandIdx];
+        value = streamBalance == NULL ? 0.0f : streamBalance[bandIdx];
+    hades_renderer_releaseControlGeneration(hHdR);
+    return value;
 }
 
 float hades_renderer_getStreamBalanceAllBands(void* const hHdR)
 {
-    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
+    float value;
     float* streamBalance;
-    streamBalance = hades_synthesis_getStreamBalancePtr(pData->hSyn, NULL);
-    return streamBalance == NULL ? 0.0f : streamBalance[0];
+    streamBalance = hades_synthesis_getStreamBalancePtr(gen==NULL ? NULL : gen->hSyn, NULL);
+    value = streamBalance == NULL ? 0.0f : streamBalance[0];
+    hades_renderer_releaseControlGeneration(hHdR);
+    return value;
 }
     
 void hades_renderer_getStreamBalanceLocalPtrs
@@ -587,15 +1132,17 @@ void hades_renderer_getStreamBalanceLocalPtrs
 )
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
     float* tmp;
 
     (*pNpoints) = pData->nBands_local;
     (*pX_vector) = pData->freqVector_local;
-    if(pData->hSyn!=NULL){
-        tmp = hades_synthesis_getStreamBalancePtr(pData->hSyn, NULL);
+    if(gen!=NULL){
+        tmp = hades_synthesis_getStreamBalancePtr(gen->hSyn, NULL);
         memcpy(pData->streamBalBands_local, tmp, pData->nBands_local*sizeof(float));
     }
     (*pY_values) = pData->streamBalBands_local;
+    hades_renderer_releaseControlGeneration(hHdR);
 }
 
 void hades_renderer_getRadialEditorPtr
@@ -610,8 +1157,10 @@ void hades_renderer_getRadialEditorPtr
 
 int hades_renderer_getNumberOfBands(void* const hHdR)
 {
-    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    return pData->hAna == NULL ? 0 : hades_analysis_getNbands(pData->hAna);
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
+    int nBands = gen == NULL ? 0 : hades_analysis_getNbands(gen->hAna);
+    hades_renderer_releaseControlGeneration(hHdR);
+    return nBands;
 }
 
 int hades_renderer_getNmicsArray(void* const hHdR)
@@ -635,7 +1184,7 @@ int hades_renderer_getIRlengthArray(void* const hHdR)
 int hades_renderer_getIRsamplerateArray(void* const hHdR)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    return pData->IR_fs;
+    return (int)(pData->IR_fs+0.5f);
 }
 
 int hades_renderer_getNDirsBin(void* const hHdR)
@@ -653,7 +1202,7 @@ int hades_renderer_getIRlengthBin(void* const hHdR)
 int hades_renderer_getIRsamplerateBin(void* const hHdR)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    return pData->binConfig.hrir_fs;
+    return (int)(pData->HRIR_fs+0.5f);
 }
 
 int hades_renderer_getDAWsamplerate(void* const hHdR)
@@ -686,8 +1235,69 @@ char* hades_renderer_getSofaFilePathHRIR(void* const hHdR)
         return "no_file";
 }
 
+const char* hades_renderer_getCacheDirectory(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->cacheDirectory!=NULL ? pData->cacheDirectory : "";
+}
+
+int hades_renderer_getCacheSizeLimit(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->cacheSizeLimit_MB;
+}
+
+int hades_renderer_getEnableIRtruncation(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->mairReduction.truncate;
+}
+
+int hades_renderer_getTargetNDirsArray(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->mairReduction.targetNumDirs;
+}
+
+float hades_renderer_getMaxSteeringErrorArray(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return pData->mairReduction.maxSteeringError_dB;
+}
+
+void hades_renderer_getDataMemoryUsage(void* const hHdR, size_t* sharedBytes, size_t* privateBytes)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_ir_set** slots[2];
+    slots[0] = &pData->mairSet;
+    slots[1] = &pData->hrirSet;
+    hades_ir_registry_getUsage(slots, 2, sharedBytes, privateBytes);
+}
+
+void hades_renderer_getProcessDataMemoryUsage(int* nDatasets, size_t* residentBytes, size_t* savedBytes)
+{
+    size_t referencedBytes;
+    hades_ir_registry_getTotalUsage(nDatasets, residentBytes, &referencedBytes);
+    (*savedBytes) = referencedBytes - (*residentBytes);
+}
+
 int hades_renderer_getProcessingDelay(void* const hHdR)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    return hades_analysis_getProcDelay(pData->hAna)+hades_synthesis_getProcDelay(pData->hSyn);
-} 
+    hades_codec_generation* gen = hades_renderer_acquireControlGeneration(hHdR);
+    int delay;
+    if(gen==NULL)
+        delay = pData->enablePipelining ? 2*pData->frameSize : pData->frameSize;
+    else
+        delay = gen->frameSize + hades_codec_generation_getDelay(gen);
+    hades_renderer_releaseControlGeneration(hHdR);
+    return delay;
+}
+
+void hades_renderer_getInitProfile(void* const hHdR, hades_renderer_init_profile* profile)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_mutex_lock(&pData->profileLock);
+    (*profile) = pData->initProfile;
+    hades_mutex_unlock(&pData->profileLock);
+}
@@ -34,14 +34,1199 @@
 #include "ehades.h"
 #include "ehades_internal.h"
 
-void hades_renderer_setCodecStatus(void* const hHdR, HADES_CODEC_STATUS newStatus)
+/* Predicates for hades_waitable_wait()/hades_waitable_waitForProcessing() */
+static int hades_renderer_isNotInitialising(void* const hHdR)
 {
     hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
-    if(newStatus==CODEC_STATUS_NOT_INITIALISED){
-        /* Pause until current initialisation is complete */
-        while(pData->codecStatus == CODEC_STATUS_INITIALISING)
-            SAF_SLEEP(10);
+    return atomic_load_explicit(&pData->codecStatus, memory_order_acquire) != CODEC_STATUS_INITIALISING;
+}
+
+typedef struct _hades_retire_ctx {
+    hades_renderer_data* pData;
+    hades_codec_generation* gen;
+} hades_retire_ctx;
+
+static int hades_renderer_isGenerationNotInUse(void* const ctx)
+{
+    hades_retire_ctx* rc = (hades_retire_ctx*)ctx;
+    hades_codec_generation* g;
+
+    /* (whatever it is fading from is destroyed along with it, and may still be the processing loop's current
+     * generation, if the loop has not picked up either of the newer ones yet) */
+    for(g=rc->gen; g!=NULL; g=atomic_load(&g->fadeFrom))
+        if(atomic_load(&rc->pData->procGen) == g || atomic_load(&rc->pData->ctrlGen) == g)
+            return 0;
+    return 1;
+}
+
+static int hades_renderer_isFadeSourceNotNeeded(void* const ctx)
+{
+    hades_retire_ctx* rc = (hades_retire_ctx*)ctx;
+    hades_codec_generation* fadeFrom = atomic_load(&rc->gen->fadeFrom);
+    if(fadeFrom!=NULL && (atomic_load(&rc->pData->ctrlGen) == fadeFrom || atomic_load(&rc->pData->procGen) == fadeFrom))
+        return 0; /* (a get/set function or the processing loop acquired it before it was unpublished) */
+    if(atomic_load_explicit(&rc->gen->fadeFinished, memory_order_acquire))
+        return 1;
+    /* Otherwise, it is only safe once 'gen' has been unpublished and the processing loop has moved on */
+    return atomic_load(&rc->pData->codecGen) != rc->gen && atomic_load(&rc->pData->procGen) != rc->gen;
+}
+
+static void hades_codec_generation_destroy(hades_codec_generation** const phGen)
+{
+    hades_codec_generation_discard(phGen);
+}
+
+void hades_codec_generation_discard(hades_codec_generation** const phGen)
+{
+    hades_codec_generation *gen = *phGen;
+    hades_codec_generation *fadeFrom;
+
+    if(gen!=NULL){
+        fadeFrom = atomic_exchange(&gen->fadeFrom, NULL);
+        hades_codec_generation_destroy(&fadeFrom);
+
+        /* Stages are only destroyed once no other generation is using them (and may be NULL if never assigned) */
+        if(gen->ana!=NULL && atomic_fetch_sub(&gen->ana->refCount, 1)==1){
+            hades_analysis_destroy(&(gen->ana->hAna));
+            hades_radial_editor_destroy(&(gen->ana->hREd));
+            free(gen->ana);
+        }
+        if(gen->con!=NULL && atomic_fetch_sub(&gen->con->refCount, 1)==1){
+            hades_param_container_destroy(&(gen->con->hPCon));
+            hades_signal_container_destroy(&(gen->con->hSCon));
+            if(gen->con->pipelined){
+                hades_param_container_destroy(&(gen->con->hPConPipe));
+                hades_signal_container_destroy(&(gen->con->hSConPipe));
+            }
+            free(gen->con);
+        }
+        if(gen->syn!=NULL && atomic_fetch_sub(&gen->syn->refCount, 1)==1){
+            hades_synthesis_destroy(&(gen->syn->hSyn));
+            free(gen->syn);
+        }
+        hades_worker_pool_destroy(&(gen->hPool));
+        free(gen);
+        (*phGen) = NULL;
+    }
+}
+
+void hades_renderer_markDirty(void* const hHdR, int stages)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    HADES_CODEC_STATUS expected;
+
+    atomic_fetch_or(&pData->dirtyStages, stages);
+
+    /* An initialisation under way is asked to stop instead (it then marks the codec as not initialised itself,
+     * after checking the flag; and since both sides use sequentially consistent operations, at least one of them
+     * always sees the other's store) */
+    atomic_store(&pData->cancelInit, 1);
+    expected = atomic_load(&pData->codecStatus);
+    while(expected!=CODEC_STATUS_INITIALISING &&
+          !atomic_compare_exchange_weak(&pData->codecStatus, &expected, CODEC_STATUS_NOT_INITIALISED)) {}
+    hades_waitable_notify(&pData->statusChanged);
+
+    if(pData->initService!=NULL)
+        hades_init_service_request(pData->initService);
+}
+
+void hades_renderer_waitWhileInitialising(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_waitable_wait(&pData->statusChanged, hades_renderer_isNotInitialising, hHdR);
+}
+
+int hades_renderer_isInitCancelled(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return atomic_load(&pData->cancelInit);
+}
+
+void hades_renderer_retireCodecGeneration(void* const hHdR, hades_codec_generation** const phGen)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation *gen = *phGen;
+    hades_retire_ctx ctx;
+
+    if(gen!=NULL){
+        /* Pause until the processing loop has moved on to the new generation */
+        ctx.pData = pData;
+        ctx.gen = gen;
+        hades_waitable_waitForProcessing(&pData->statusChanged, hades_renderer_isGenerationNotInUse, &ctx, -1);
+        hades_codec_generation_destroy(phGen);
+    }
+}
+
+void hades_renderer_releaseFadeSource(void* const hHdR, hades_codec_generation* const gen, int timeout_ms)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation *fadeFrom;
+    hades_retire_ctx ctx;
+
+    if(gen==NULL || atomic_load(&gen->fadeFrom)==NULL)
+        return;
+    ctx.pData = pData;
+    ctx.gen = gen;
+    if(hades_waitable_waitForProcessing(&pData->statusChanged, hades_renderer_isFadeSourceNotNeeded, &ctx, timeout_ms)){
+        fadeFrom = atomic_exchange(&gen->fadeFrom, NULL);
+        hades_codec_generation_destroy(&fadeFrom);
+    }
+}
+
+int hades_renderer_collectFadeSource(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation *gen;
+    int pending;
+
+    /* (the current generation cannot be retired meanwhile, see hades_renderer_initCodec()) */
+    hades_mutex_lock(&pData->retireLock);
+    gen = atomic_load(&pData->codecGen);
+    hades_renderer_releaseFadeSource(hHdR, gen, 0);
+    pending = gen!=NULL && atomic_load(&gen->fadeFrom)!=NULL;
+    hades_mutex_unlock(&pData->retireLock);
+    return pending;
+}
+
+/* Flags the current codec generation as in use, via the given hazard slot ('procGen' or 'ctrlGen') */
+static hades_codec_generation* hades_renderer_acquireGeneration(hades_renderer_data* pData,
+                                                                _Atomic(hades_codec_generation*)* slot)
+{
+    hades_codec_generation *gen;
+
+    /* (re-checked in case a new generation was published meanwhile). Note: sequentially consistent ordering is
+     * required here, as the store to the slot must be visible before 'codecGen' is re-loaded */
+    do {
+        gen = atomic_load(&pData->codecGen);
+        atomic_store(slot, gen);
+    } while (gen != atomic_load(&pData->codecGen));
+    return gen;
+}
+
+hades_codec_generation* hades_renderer_acquireCodecGeneration(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    return hades_renderer_acquireGeneration(pData, &pData->procGen);
+}
+
+void hades_renderer_releaseCodecGeneration(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    atomic_store(&pData->procGen, NULL);
+    hades_waitable_post(&pData->statusChanged);
+}
+
+hades_codec_generation* hades_renderer_acquireControlGeneration(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_mutex_lock(&pData->ctrlLock);
+    return hades_renderer_acquireGeneration(pData, &pData->ctrlGen);
+}
+
+void hades_renderer_releaseControlGeneration(void* const hHdR)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    atomic_store(&pData->ctrlGen, NULL);
+    hades_waitable_notify(&pData->statusChanged);
+    hades_mutex_unlock(&pData->ctrlLock);
+}
+
+/* Ends the crossfade from the outgoing generation early (e.g. as there is nothing to crossfade during silence) */
+static void hades_renderer_endCrossfade(hades_renderer_data* pData, hades_codec_generation* const gen)
+{
+    if(pData->fadeFrameIdx < gen->nFadeFrames){
+        pData->fadeFrameIdx = gen->nFadeFrames;
+        atomic_store_explicit(&gen->fadeFinished, 1, memory_order_release);
+        hades_waitable_post(&pData->statusChanged);
+    }
+}
+
+void hades_renderer_processCodecFrame
+(
+    void* const hHdR,
+    hades_codec_generation* const gen,
+    float** inFrame,
+    float** outFrame
+)
+{
+    hades_renderer_data *pData = (hades_renderer_data*)(hHdR);
+    hades_codec_generation *fadeGen;
+    hades_job_fn jobFns[2];
+    void* jobArgs[2];
+    float** newFrame;
+    int n, ch, nJobs, nRampSamples, rampIdx, tailLength, sharedAnalysis, reopened;
+    float w, energy;
+
+    /* Has a new codec generation been picked up since the last frame? */
+    if(gen->id != pData->fadeGenId){
+        pData->fadeGenId = gen->id;
+        pData->fadeFrameIdx = 0;
+    }
+
+    /* Silence gate */
+    if(pData->enableSilenceGate){
+        energy = 0.0f;
+        for(ch=0; ch<gen->nMics && energy<=SILENCE_GATE_THRESHOLD*(float)gen->frameSize; ch++)
+            energy += cblas_sdot(gen->frameSize, inFrame[ch], 1, inFrame[ch], 1);
+        if(energy<=SILENCE_GATE_THRESHOLD*(float)gen->frameSize){
+            /* Once the input has been silent for longer than the filterbank tail, the output is silent too */
+            tailLength = hades_codec_generation_getDelay(gen);
+            if(pData->silentSamples >= tailLength){
+                /* (nothing to crossfade during silence, including from generations published while gated) */
+                pData->isGated = 1;
+                hades_renderer_endCrossfade(pData, gen);
+                for(ch=0; ch<NUM_EARS; ch++)
+                    memset(outFrame[ch], 0, gen->frameSize*sizeof(float));
+                return;
+            }
+            pData->silentSamples += gen->frameSize;
+        }
+        else
+            pData->silentSamples = 0;
+    }
+    reopened = pData->isGated;
+    if(reopened){
+        /* Signal has returned (or the gate was disabled); start again from clean filterbank/averaging states,
+         * as if the codec had processed the silence. The outgoing generation's states are just as stale, so any
+         * crossfade from it is not resumed, and nothing analysed before the gate closed is synthesised */
+        hades_analysis_reset(gen->hAna);
+        hades_synthesis_reset(gen->hSyn);
+        hades_renderer_endCrossfade(pData, gen);
+        if(gen->con->pipelined){
+            for(ch=0; ch<gen->nMics; ch++)
+                memset(pData->pipeInFrameTD[ch], 0, gen->frameSize*sizeof(float));
+        }
+        pData->isGated = 0;
+    }
+    fadeGen = NULL;
+    if(pData->fadeFrameIdx < gen->nFadeFrames)
+        fadeGen = atomic_load(&gen->fadeFrom);
+
+    /* If only the synthesis has changed, then the outgoing generation shares the analysis and containers with the
+     * incoming one, and so the frame is analysed once, and then synthesised by both */
+    sharedAnalysis = fadeGen!=NULL && fadeGen->ana==gen->ana && fadeGen->con==gen->con;
+
+    newFrame = outFrame;
+    if(gen->con->pipelined){
+        /* Pipelined: this frame is analysed by the worker pool, while the frame analysed last time is synthesised
+         * here. (The outgoing generation is always in the same mode, see hades_renderer_initCodec()). The analysis
+         * reads its own copy of the input, so that the synthesis may write to 'outFrame' straight away, even if it
+         * shares memory with 'inFrame' */
+        for(ch=0; ch<gen->nMics; ch++)
+            memcpy(pData->pipeInFrameTD[ch], inFrame[ch], gen->frameSize*sizeof(float));
+        nJobs = 0;
+        pData->applyJobs[nJobs] = (hades_apply_job){ gen, pData->pipeInFrameTD, pData->dirGain_dB, NULL };
+        jobFns[nJobs] = hades_codec_generation_analyseJob;
+        jobArgs[nJobs] = &pData->applyJobs[nJobs];
+        nJobs++;
+        if(fadeGen!=NULL && !sharedAnalysis){
+            pData->applyJobs[nJobs] = (hades_apply_job){ fadeGen, pData->pipeInFrameTD, pData->dirGain_dB, NULL };
+            jobFns[nJobs] = hades_codec_generation_analyseJob;
+            jobArgs[nJobs] = &pData->applyJobs[nJobs];
+            nJobs++;
+        }
+        hades_worker_pool_post(gen->hPool, jobFns, jobArgs, nJobs);
+        if(reopened){
+            /* The containers due to be synthesised still hold the last frame analysed before the gate closed (and
+             * SAF offers no way to clear them), so the silence that this frame stands for is output instead */
+            for(ch=0; ch<NUM_EARS; ch++)
+                memset(outFrame[ch], 0, gen->frameSize*sizeof(float));
+        }
+        else
+            hades_codec_generation_synthesise(gen, outFrame);
+        if(fadeGen!=NULL)
+            hades_codec_generation_synthesise(fadeGen, pData->fadeFrameTD);
+        hades_worker_pool_join(gen->hPool);
+
+        /* The frame that was just analysed is synthesised next time */
+        hades_codec_generation_swapContainers(gen);
+        if(fadeGen!=NULL && !sharedAnalysis)
+            hades_codec_generation_swapContainers(fadeGen);
+    }
+    else if(sharedAnalysis){
+        hades_codec_generation_analyse(gen, inFrame, pData->dirGain_dB);
+        hades_codec_generation_swapContainers(gen);
+        if(gen->hPool!=NULL){
+            /* (both read the same containers, which the synthesis does not modify) */
+            newFrame = pData->newFrameTD;
+            pData->applyJobs[0] = (hades_apply_job){ fadeGen, NULL, NULL, pData->fadeFrameTD };
+            pData->applyJobs[1] = (hades_apply_job){ gen, NULL, NULL, newFrame };
+            jobFns[0] = jobFns[1] = hades_codec_generation_synthesiseJob;
+            jobArgs[0] = &pData->applyJobs[0];
+            jobArgs[1] = &pData->applyJobs[1];
+            hades_worker_pool_post(gen->hPool, jobFns, jobArgs, 2);
+            hades_worker_pool_join(gen->hPool);
+        }
+        else{
+            hades_codec_generation_synthesise(fadeGen, pData->fadeFrameTD);
+            hades_codec_generation_synthesise(gen, outFrame);
+        }
+    }
+    else if(fadeGen!=NULL && gen->hPool!=NULL){
+        /* Run the outgoing and incoming generations in parallel (into separate buffers, as 'inFrame' and 'outFrame'
+         * may share the same memory) */
+        newFrame = pData->newFrameTD;
+        pData->applyJobs[0] = (hades_apply_job){ fadeGen, inFrame, pData->dirGain_dB, pData->fadeFrameTD };
+        pData->applyJobs[1] = (hades_apply_job){ gen, inFrame, pData->dirGain_dB, newFrame };
+        jobFns[0] = jobFns[1] = hades_codec_generation_applyJob;
+        jobArgs[0] = &pData->applyJobs[0];
+        jobArgs[1] = &pData->applyJobs[1];
+        hades_worker_pool_post(gen->hPool, jobFns, jobArgs, 2);
+        hades_worker_pool_join(gen->hPool);
     }
-    pData->codecStatus = newStatus;
+    else{
+        /* The outgoing generation goes first, as 'inFrame' and 'outFrame' may share the same memory */
+        if(fadeGen!=NULL)
+            hades_codec_generation_apply(fadeGen, inFrame, pData->dirGain_dB, pData->fadeFrameTD);
+        hades_codec_generation_apply(gen, inFrame, pData->dirGain_dB, outFrame);
+    }
+
+    /* Crossfade from the outgoing generation */
+    if(fadeGen!=NULL){
+        nRampSamples = (gen->nFadeFrames - gen->nFadeWarmupFrames)*gen->frameSize;
+        rampIdx = (pData->fadeFrameIdx - gen->nFadeWarmupFrames)*gen->frameSize;
+        for(n=0; n<gen->frameSize; n++){
+            w = SAF_CLAMP((float)(rampIdx+n+1)/(float)nRampSamples, 0.0f, 1.0f);
+            for(ch=0; ch<NUM_EARS; ch++)
+                outFrame[ch][n] = w*newFrame[ch][n] + (1.0f-w)*pData->fadeFrameTD[ch][n];
+        }
+    }
+    else if(newFrame!=outFrame){
+        for(ch=0; ch<NUM_EARS; ch++)
+            memcpy(outFrame[ch], newFrame[ch], gen->frameSize*sizeof(float));
+    }
+    if(pData->fadeFrameIdx < gen->nFadeFrames && ++(pData->fadeFrameIdx) == gen->nFadeFrames){
+        /* Outgoing generation is no longer needed */
+        atomic_store_explicit(&gen->fadeFinished, 1, memory_order_release);
+        hades_waitable_post(&pData->statusChanged);
+    }
+}
+
+void hades_codec_generation_analyse
+(
+    hades_codec_generation* const gen,
+    float** inFrame,
+    float* dirGain_dB
+)
+{
+    hades_param_container_handle hPCon;
+    hades_signal_container_handle hSCon;
+
+    /* (when pipelined, the other set of containers is still to be synthesised) */
+    hPCon = gen->con->hPConPipe!=NULL ? gen->con->hPConPipe : gen->con->hPCon;
+    hSCon = gen->con->hSConPipe!=NULL ? gen->con->hSConPipe : gen->con->hSCon;
+
+    /* Apply hades analysis */
+    hades_analysis_apply(gen->hAna, inFrame, gen->nMics, gen->frameSize, hPCon, hSCon);
+
+    /* Apply the hades parameter radial editor */
+    hades_radial_editor_apply(gen->hREd, hPCon, dirGain_dB);
+}
+
+void hades_codec_generation_synthesise
+(
+    hades_codec_generation* const gen,
+    float** outFrame
+)
+{
+    /* Apply hades synthesis */
+    hades_synthesis_apply(gen->hSyn, gen->con->hPCon, gen->con->hSCon, NUM_EARS, gen->frameSize, outFrame);
+}
+
+void hades_codec_generation_apply
+(
+    hades_codec_generation* const gen,
+    float** inFrame,
+    float* dirGain_dB,
+    float** outFrame
+)
+{
+    hades_codec_generation_analyse(gen, inFrame, dirGain_dB);
+    hades_codec_generation_swapContainers(gen); /* (if pipelined, the frame is still synthesised straight away) */
+    hades_codec_generation_synthesise(gen, outFrame);
 }
 
+void hades_codec_generation_swapContainers(hades_codec_generation* const gen)
+{
+    hades_container_stage* con = gen->con;
+    hades_param_container_handle hPCon;
+    hades_signal_container_handle hSCon;
+
+    if(con->pipelined){
+        hPCon = con->hPCon;
+        hSCon = con->hSCon;
+        con->hPCon = con->hPConPipe;
+        con->hSCon = con->hSConPipe;
+        con->hPConPipe = hPCon;
+        con->hSConPipe = hSCon;
+    }
+}
+
+int hades_codec_generation_getDelay(hades_codec_generation* const gen)
+{
+    return hades_analysis_getProcDelay(gen->hAna) + hades_synthesis_getProcDelay(gen->hSyn) +
+           (gen->con->pipelined ? gen->frameSize : 0); /* (+1 frame when pipelined) */
+}
+
+void hades_codec_generation_applyJob(void* arg)
+{
+    hades_apply_job* job = (hades_apply_job*)arg;
+    hades_codec_generation_apply(job->gen, job->inFrame, job->dirGain_dB, job->outFrame);
+}
+
+void hades_codec_generation_analyseJob(void* arg)
+{
+    hades_apply_job* job = (hades_apply_job*)arg;
+    hades_codec_generation_analyse(job->gen, job->inFrame, job->dirGain_dB);
+}
+
+void hades_codec_generation_synthesiseJob(void* arg)
+{
+    hades_apply_job* job = (hades_apply_job*)arg;
+    hades_codec_generation_synthesise(job->gen, job->outFrame);
+}
+
+/* Per-worker state */
+typedef struct _hades_worker_ctx {
+    hades_worker_pool* pool;
+    unsigned int lastBatchId;                /* ID of the last batch this worker has looked at */
+} hades_worker_ctx;
+
+#define POOL_BATCH_SHIFT ( 8 )
+#define POOL_JOB_MASK ( (1u<<POOL_BATCH_SHIFT)-1u ) /* (a job index equal to the mask means "batch is being posted") */
+#define POOL_SPIN_COUNT ( 4096 )  /* Number of polls, before a worker parks (or the joining thread starts yielding) */
+
+/* Claims and runs jobs of the current batch, until there are none left */
+static void hades_worker_pool_runJobs(hades_worker_pool* const pool)
+{
+    unsigned int v;
+    int idx;
+
+    v = atomic_load(&pool->claim);
+    for(;;){
+        idx = (int)(v & POOL_JOB_MASK);
+        if(idx >= atomic_load(&pool->nJobs))
+            return;
+        if(atomic_compare_exchange_weak(&pool->claim, &v, v+1u)){
+            pool->jobFn[idx](pool->jobArg[idx]);
+            atomic_fetch_add(&pool->nDone, 1);
+            v = atomic_load(&pool->claim);
+        }
+    }
+}
+
+static int hades_worker_hasWork(hades_worker_ctx* const wc)
+{
+    return atomic_load(&wc->pool->quit) || (atomic_load(&wc->pool->claim)>>POOL_BATCH_SHIFT) != wc->lastBatchId;
+}
+
+static int hades_worker_pool_isBatchDone(hades_worker_pool* const pool)
+{
+    return atomic_load(&pool->nDone) >= atomic_load(&pool->nJobs);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI hades_worker_main(LPVOID arg)
+#else
+static void* hades_worker_main(void* arg)
+#endif
+{
+    hades_worker_ctx* wc = (hades_worker_ctx*)arg;
+    hades_worker_pool* pool = wc->pool;
+    unsigned int v;
+    int i;
+
+    for(;;){
+        /* Spin for a short while (batches are often posted back-to-back), before parking until the next batch.
+         * Note: 'nParked' is raised before the final check, and the posting thread publishes the batch before
+         * reading 'nParked' (both sequentially consistent), so at least one of them always sees the other */
+        for(i=0; i<POOL_SPIN_COUNT && !hades_worker_hasWork(wc); i++) {}
+        if(!hades_worker_hasWork(wc)){
+            atomic_fetch_add(&pool->nParked, 1);
+            if(!hades_worker_hasWork(wc))
+                hades_semaphore_wait(&pool->wake);
+            atomic_fetch_sub(&pool->nParked, 1);
+            continue; /* (may have been woken by a post meant for an earlier park, so check again) */
+        }
+        if(atomic_load(&pool->quit))
+            break;
+        v = atomic_load(&pool->claim);
+        if((v & POOL_JOB_MASK) == POOL_JOB_MASK)
+            continue; /* (batch is still being posted) */
+        wc->lastBatchId = v>>POOL_BATCH_SHIFT;
+        hades_worker_pool_runJobs(pool);
+    }
+    return 0;
+}
+
+void hades_worker_pool_create(hades_worker_pool** const phPool, int nThreads)
+{
+    hades_worker_pool* pool = (hades_worker_pool*)malloc1d(sizeof(hades_worker_pool));
+    int i;
+
+    pool->nThreads = 0;
+    hades_semaphore_create(&pool->wake);
+    atomic_init(&pool->nParked, 0);
+    atomic_init(&pool->quit, 0);
+    atomic_init(&pool->claim, 0);
+    atomic_init(&pool->nJobs, 0);
+    atomic_init(&pool->nDone, 0);
+    pool->batchId = 0;
+    pool->workers = (hades_worker_ctx*)malloc1d(nThreads*sizeof(hades_worker_ctx));
+#ifdef _WIN32
+    pool->threads = (HANDLE*)malloc1d(nThreads*sizeof(HANDLE));
+#else
+    pool->threads = (pthread_t*)malloc1d(nThreads*sizeof(pthread_t));
+#endif
+    for(i=0; i<nThreads; i++){
+        pool->workers[pool->nThreads].pool = pool;
+        pool->workers[pool->nThreads].lastBatchId = 0;
+#ifdef _WIN32
+        pool->threads[pool->nThreads] = CreateThread(NULL, 0, hades_worker_main, &pool->workers[pool->nThreads], 0, NULL);
+        if(pool->threads[pool->nThreads]!=NULL)
+            pool->nThreads++;
+#else
+        if(pthread_create(&pool->threads[pool->nThreads], NULL, hades_worker_main, &pool->workers[pool->nThreads])==0)
+            pool->nThreads++;
+#endif
+    }
+    /* (if no threads could be spawned, then the posting thread simply runs all jobs itself) */
+    (*phPool) = pool;
+}
+
+void hades_worker_pool_destroy(hades_worker_pool** const phPool)
+{
+    hades_worker_pool* pool = *phPool;
+    int i;
+
+    if(pool!=NULL){
+        atomic_store(&pool->quit, 1);
+        hades_semaphore_post(&pool->wake, pool->nThreads);
+        for(i=0; i<pool->nThreads; i++){
+#ifdef _WIN32
+            WaitForSingleObject(pool->threads[i], INFINITE);
+            CloseHandle(pool->threads[i]);
+#else
+            pthread_join(pool->threads[i], NULL);
+#endif
+        }
+        hades_semaphore_destroy(&pool->wake);
+        free(pool->threads);
+        free(pool->workers);
+        free(pool);
+        (*phPool) = NULL;
+    }
+}
+
+void hades_worker_pool_post(hades_worker_pool* const hPool, const hades_job_fn* fns, void* const* args, int nJobs)
+{
+    int i, nParked;
+
+    nJobs = SAF_MIN(nJobs, MAX_NUM_POOL_JOBS);
+    hPool->batchId = (hPool->batchId+1u) & (~0u>>POOL_BATCH_SHIFT);
+
+    /* Close the previous batch first, so that late workers cannot claim the new jobs before the batch is published */
+    atomic_store(&hPool->claim, (hPool->batchId<<POOL_BATCH_SHIFT) | POOL_JOB_MASK);
+    for(i=0; i<nJobs; i++){
+        hPool->jobFn[i] = fns[i];
+        hPool->jobArg[i] = args[i];
+    }
+    atomic_store(&hPool->nDone, 0);
+    atomic_store(&hPool->nJobs, nJobs);
+    atomic_store(&hPool->claim, hPool->batchId<<POOL_BATCH_SHIFT); /* (publishes the batch) */
+
+    /* Workers that are still spinning pick the batch up by themselves; only parked ones need waking */
+    nParked = atomic_load(&hPool->nParked);
+    if(nParked > 0)
+        hades_semaphore_post(&hPool->wake, SAF_MIN(nParked, nJobs));
+}
+
+void hades_worker_pool_join(hades_worker_pool* const hPool)
+{
+    int i;
+
+    hades_worker_pool_runJobs(hPool);
+
+    /* Only jobs already being run by the workers are left, so this spins (rather than blocking on anything that
+     * the processing loop must not), yielding the CPU if they take a while longer */
+    for(i=0; !hades_worker_pool_isBatchDone(hPool); i++){
+        if(i>=POOL_SPIN_COUNT){
+#ifdef _WIN32
+            SwitchToThread();
+#else
+            sched_yield();
+#endif
+        }
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI hades_init_service_main(LPVOID arg)
+#else
+static void* hades_init_service_main(void* arg)
+#endif
+{
+    hades_init_service* svc = (hades_init_service*)arg;
+    hades_renderer_data *pData = (hades_renderer_data*)(svc->hHdR);
+    int requested, fadePending;
+#ifndef _WIN32
+    struct timespec deadline;
+#endif
+
+    /* Initialisations are long and never time-critical, so they should not compete with the host's threads */
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#elif defined(__linux__)
+    setpriority(PRIO_PROCESS, 0, 10); /* (on Linux, this only applies to the calling thread) */
+#endif
+
+    /* While the processing loop is crossfading to a new codec generation, the service wakes up every so often to
+     * destroy the outgoing one once it is done with (rather than the initialisation waiting for that) */
+    fadePending = 0;
+    for(;;){
+#ifdef _WIN32
+        AcquireSRWLockExclusive(&svc->lock);
+        if(fadePending && !svc->requested && !svc->quit)
+            SleepConditionVariableSRW(&svc->cond, &svc->lock, FADE_SOURCE_POLL_MS, 0);
+        while(!fadePending && !svc->requested && !svc->quit)
+            SleepConditionVariableSRW(&svc->cond, &svc->lock, INFINITE, 0);
+        if(svc->quit){
+            ReleaseSRWLockExclusive(&svc->lock);
+            break;
+        }
+        requested = svc->requested;
+        svc->requested = 0; /* (requests made from now on will run another initialisation) */
+        ReleaseSRWLockExclusive(&svc->lock);
+#else
+        pthread_mutex_lock(&svc->lock);
+        if(fadePending && !svc->requested && !svc->quit){
+            timespec_get(&deadline, TIME_UTC); /* (same clock as pthread_cond_timedwait) */
+            deadline.tv_nsec += (long)FADE_SOURCE_POLL_MS*1000000;
+            if(deadline.tv_nsec >= 1000000000){
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&svc->cond, &svc->lock, &deadline);
+        }
+        while(!fadePending && !svc->requested && !svc->quit)
+            pthread_cond_wait(&svc->cond, &svc->lock);
+        if(svc->quit){
+            pthread_mutex_unlock(&svc->lock);
+            break;
+        }
+        requested = svc->requested;
+        svc->requested = 0; /* (requests made from now on will run another initialisation) */
+        pthread_mutex_unlock(&svc->lock);
+#endif
+        if(requested && atomic_load(&pData->codecStatus)==CODEC_STATUS_NOT_INITIALISED)
+            hades_renderer_initCodec(svc->hHdR);
+        fadePending = hades_renderer_collectFadeSource(svc->hHdR);
+    }
+    return 0;
+}
+
+int hades_init_service_create(hades_init_service** const phSvc, void* const hHdR)
+{
+    hades_init_service* svc = (hades_init_service*)malloc1d(sizeof(hades_init_service));
+
+    svc->hHdR = hHdR;
+    svc->requested = 1; /* (so that a codec that is not yet initialised is initialised straight away) */
+    svc->quit = 0;
+#ifdef _WIN32
+    InitializeSRWLock(&svc->lock);
+    InitializeConditionVariable(&svc->cond);
+    svc->thread = CreateThread(NULL, 0, hades_init_service_main, svc, 0, NULL);
+    if(svc->thread==NULL){
+        free(svc);
+        svc = NULL;
+    }
+#else
+    pthread_mutex_init(&svc->lock, NULL);
+    pthread_cond_init(&svc->cond, NULL);
+    if(pthread_create(&svc->thread, NULL, hades_init_service_main, svc)!=0){
+        pthread_cond_destroy(&svc->cond);
+        pthread_mutex_destroy(&svc->lock);
+        free(svc);
+        svc = NULL;
+    }
+#endif
+    (*phSvc) = svc;
+    return svc!=NULL;
+}
+
+void hades_init_service_destroy(hades_init_service** const phSvc)
+{
+    hades_init_service* svc = *phSvc;
+
+    if(svc!=NULL){
+#ifdef _WIN32
+        AcquireSRWLockExclusive(&svc->lock);
+        svc->quit = 1;
+        WakeConditionVariable(&svc->cond);
+        ReleaseSRWLockExclusive(&svc->lock);
+        WaitForSingleObject(svc->thread, INFINITE);
+        CloseHandle(svc->thread);
+#else
+        pthread_mutex_lock(&svc->lock);
+        svc->quit = 1;
+        pthread_cond_signal(&svc->cond);
+        pthread_mutex_unlock(&svc->lock);
+        pthread_join(svc->thread, NULL);
+        pthread_cond_destroy(&svc->cond);
+        pthread_mutex_destroy(&svc->lock);
+#endif
+        free(svc);
+        (*phSvc) = NULL;
+    }
+}
+
+void hades_init_service_request(hades_init_service* const hSvc)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&hSvc->lock);
+    hSvc->requested = 1;
+    WakeConditionVariable(&hSvc->cond);
+    ReleaseSRWLockExclusive(&hSvc->lock);
+#else
+    pthread_mutex_lock(&hSvc->lock);
+    hSvc->requested = 1;
+    pthread_cond_signal(&hSvc->cond);
+    pthread_mutex_unlock(&hSvc->lock);
+#endif
+}
+
+void hades_mutex_create(hades_mutex* const m)
+{
+#ifdef _WIN32
+    InitializeSRWLock(&m->lock);
+#else
+    pthread_mutex_init(&m->lock, NULL);
+#endif
+}
+
+void hades_mutex_destroy(hades_mutex* const m)
+{
+#ifndef _WIN32
+    pthread_mutex_destroy(&m->lock);
+#else
+    (void)m; /* nothing to free */
+#endif
+}
+
+void hades_mutex_lock(hades_mutex* const m)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&m->lock);
+#else
+    pthread_mutex_lock(&m->lock);
+#endif
+}
+
+void hades_mutex_unlock(hades_mutex* const m)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&m->lock);
+#else
+    pthread_mutex_unlock(&m->lock);
+#endif
+}
+
+void hades_semaphore_create(hades_semaphore* const s)
+{
+#if defined(_WIN32)
+    s->sem = CreateSemaphore(NULL, 0, MAXLONG, NULL);
+#elif defined(__APPLE__)
+    s->sem = dispatch_semaphore_create(0);
+#else
+    sem_init(&s->sem, 0, 0);
+#endif
+}
+
+void hades_semaphore_destroy(hades_semaphore* const s)
+{
+#if defined(_WIN32)
+    CloseHandle(s->sem);
+#elif defined(__APPLE__)
+    dispatch_release(s->sem);
+#else
+    sem_destroy(&s->sem);
+#endif
+}
+
+void hades_semaphore_wait(hades_semaphore* const s)
+{
+#if defined(_WIN32)
+    WaitForSingleObject(s->sem, INFINITE);
+#elif defined(__APPLE__)
+    dispatch_semaphore_wait(s->sem, DISPATCH_TIME_FOREVER);
+#else
+    while(sem_wait(&s->sem)!=0) {} /* (retried if interrupted by a signal) */
+#endif
+}
+
+void hades_semaphore_post(hades_semaphore* const s, int n)
+{
+#if defined(_WIN32)
+    if(n > 0)
+        ReleaseSemaphore(s->sem, (LONG)n, NULL);
+#else
+    for(; n>0; n--){
+# ifdef __APPLE__
+        dispatch_semaphore_signal(s->sem);
+# else
+        sem_post(&s->sem);
+# endif
+    }
+#endif
+}
+
+void hades_progress_begin(hades_progress* const p, int nTotal)
+{
+    if(p!=NULL){
+        p->nTotal = SAF_MAX(nTotal, 1);
+        atomic_store(&p->nDone, 0);
+        hades_progress_advance(p, 0);
+    }
+}
+
+void hades_progress_advance(hades_progress* const p, int nItems)
+{
+    float value, current;
+
+    if(p==NULL || p->bar==NULL)
+        return;
+    value = p->start + p->span * (float)SAF_MIN(atomic_fetch_add(&p->nDone, nItems)+nItems, p->nTotal)/(float)p->nTotal;
+    current = atomic_load(p->bar);
+    while(current<value && !atomic_compare_exchange_weak(p->bar, &current, value)) {}
+}
+
+/* Post service: a process-wide background thread, which turns the processing loops' posts into notifications, while
+ * any thread is waiting on a waitable that is posted (see hades_waitable_post()) */
+#ifdef _WIN32
+static SRWLOCK postServiceLifeLock = SRWLOCK_INIT;            /* Guards 'postServiceRefCount' and the thread */
+static SRWLOCK postServiceLock = SRWLOCK_INIT;                /* Guards 'postServiceRunning' and the watched list */
+static CONDITION_VARIABLE postServiceCond = CONDITION_VARIABLE_INIT;
+static HANDLE postServiceThread = NULL;
+#else
+static pthread_mutex_t postServiceLifeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t postServiceLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t postServiceCond = PTHREAD_COND_INITIALIZER;
+static pthread_t postServiceThread;
+#endif
+static int postServiceRefCount = 0;                           /* Number of holders (renderer instances) */
+static int postServiceStarted = 0;                            /* 1: the thread was started, and is yet to be joined */
+static int postServiceRunning = 0;                            /* 1: the thread is running, and may be asked to watch */
+static hades_waitable* postServiceWatched = NULL;             /* Waitables being watched (linked via 'nextWatched') */
+
+#ifndef _WIN32
+/* Advances a time point (as used by pthread_cond_timedwait) by 'ms' milliseconds */
+static void hades_timespec_addMs(struct timespec* const ts, int ms)
+{
+    ts->tv_sec += ms/1000;
+    ts->tv_nsec += (long)(ms%1000)*1000000;
+    if(ts->tv_nsec >= 1000000000){
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+static int hades_timespec_isBefore(const struct timespec* const a, const struct timespec* const b)
+{
+    return a->tv_sec<b->tv_sec || (a->tv_sec==b->tv_sec && a->tv_nsec<b->tv_nsec);
+}
+#endif
+
+#ifdef _WIN32
+static DWORD WINAPI hades_post_service_main(LPVOID arg)
+#else
+static void* hades_post_service_main(void* arg)
+#endif
+{
+    hades_waitable* w;
+#ifndef _WIN32
+    struct timespec ts;
+#endif
+    (void)arg;
+
+    /* Note: the waiters never hold a waitable's lock while taking 'postServiceLock', so notifying under it is fine */
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&postServiceLock);
+    while(postServiceRunning){
+        if(postServiceWatched==NULL){
+            SleepConditionVariableSRW(&postServiceCond, &postServiceLock, INFINITE, 0);
+            continue;
+        }
+        for(w=postServiceWatched; w!=NULL; w=w->nextWatched)
+            if(atomic_exchange(&w->posted, 0))
+                hades_waitable_notify(w);
+        SleepConditionVariableSRW(&postServiceCond, &postServiceLock, POST_SERVICE_POLL_MS, 0);
+    }
+    ReleaseSRWLockExclusive(&postServiceLock);
+#else
+    pthread_mutex_lock(&postServiceLock);
+    while(postServiceRunning){
+        if(postServiceWatched==NULL){
+            pthread_cond_wait(&postServiceCond, &postServiceLock);
+            continue;
+        }
+        for(w=postServiceWatched; w!=NULL; w=w->nextWatched)
+            if(atomic_exchange(&w->posted, 0))
+                hades_waitable_notify(w);
+        timespec_get(&ts, TIME_UTC); /* (same clock as pthread_cond_timedwait) */
+        hades_timespec_addMs(&ts, POST_SERVICE_POLL_MS);
+        pthread_cond_timedwait(&postServiceCond, &postServiceLock, &ts);
+    }
+    pthread_mutex_unlock(&postServiceLock);
+#endif
+    return 0;
+}
+
+void hades_post_service_retain(void)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&postServiceLifeLock);
+    if(postServiceRefCount++ == 0){
+        AcquireSRWLockExclusive(&postServiceLock);
+        postServiceRunning = 1;
+        ReleaseSRWLockExclusive(&postServiceLock);
+        postServiceThread = CreateThread(NULL, 0, hades_post_service_main, NULL, 0, NULL);
+        postServiceStarted = postServiceThread!=NULL;
+        if(!postServiceStarted){
+            AcquireSRWLockExclusive(&postServiceLock);
+            postServiceRunning = 0;
+            ReleaseSRWLockExclusive(&postServiceLock);
+        }
+    }
+    ReleaseSRWLockExclusive(&postServiceLifeLock);
+#else
+    pthread_mutex_lock(&postServiceLifeLock);
+    if(postServiceRefCount++ == 0){
+        pthread_mutex_lock(&postServiceLock);
+        postServiceRunning = 1;
+        pthread_mutex_unlock(&postServiceLock);
+        postServiceStarted = pthread_create(&postServiceThread, NULL, hades_post_service_main, NULL)==0;
+        if(!postServiceStarted){
+            pthread_mutex_lock(&postServiceLock);
+            postServiceRunning = 0;
+            pthread_mutex_unlock(&postServiceLock);
+        }
+    }
+    pthread_mutex_unlock(&postServiceLifeLock);
+#endif
+}
+
+void hades_post_service_release(void)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&postServiceLifeLock);
+    if(--postServiceRefCount == 0 && postServiceStarted){
+        AcquireSRWLockExclusive(&postServiceLock);
+        postServiceRunning = 0;
+        WakeAllConditionVariable(&postServiceCond);
+        ReleaseSRWLockExclusive(&postServiceLock);
+        WaitForSingleObject(postServiceThread, INFINITE);
+        CloseHandle(postServiceThread);
+        postServiceStarted = 0;
+    }
+    ReleaseSRWLockExclusive(&postServiceLifeLock);
+#else
+    pthread_mutex_lock(&postServiceLifeLock);
+    if(--postServiceRefCount == 0 && postServiceStarted){
+        pthread_mutex_lock(&postServiceLock);
+        postServiceRunning = 0;
+        pthread_cond_broadcast(&postServiceCond);
+        pthread_mutex_unlock(&postServiceLock);
+        pthread_join(postServiceThread, NULL);
+        postServiceStarted = 0;
+    }
+    pthread_mutex_unlock(&postServiceLifeLock);
+#endif
+}
+
+/* Asks the post service to watch a waitable; returns 0 if it is not running */
+static int hades_post_service_watch(hades_waitable* const w)
+{
+    int watching;
+
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&postServiceLock);
+#else
+    pthread_mutex_lock(&postServiceLock);
+#endif
+    watching = postServiceRunning;
+    if(watching && w->nWatchers++ == 0){
+        w->nextWatched = postServiceWatched;
+        postServiceWatched = w;
+#ifdef _WIN32
+        WakeAllConditionVariable(&postServiceCond);
+#else
+        pthread_cond_broadcast(&postServiceCond);
+#endif
+    }
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&postServiceLock);
+#else
+    pthread_mutex_unlock(&postServiceLock);
+#endif
+    return watching;
+}
+
+static void hades_post_service_unwatch(hades_waitable* const w)
+{
+    hades_waitable** link;
+
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&postServiceLock);
+#else
+    pthread_mutex_lock(&postServiceLock);
+#endif
+    if(--w->nWatchers == 0){
+        for(link=&postServiceWatched; *link!=w; link=&((*link)->nextWatched)) {}
+        (*link) = w->nextWatched;
+        w->nextWatched = NULL;
+    }
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&postServiceLock);
+#else
+    pthread_mutex_unlock(&postServiceLock);
+#endif
+}
+
+void hades_waitable_create(hades_waitable* const w)
+{
+#ifdef _WIN32
+    InitializeSRWLock(&w->lock);
+    InitializeConditionVariable(&w->cond);
+#else
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+#endif
+    atomic_init(&w->nWaiters, 0);
+    atomic_init(&w->posted, 0);
+    w->nWatchers = 0;
+    w->nextWatched = NULL;
+}
+
+void hades_waitable_destroy(hades_waitable* const w)
+{
+#ifndef _WIN32
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+#else
+    (void)w; /* nothing to free */
+#endif
+}
+
+/* Blocks until the predicate is satisfied, or 'timeout_ms' have passed (negative: no limit). If 'poll_ms' is positive,
+ * then the predicate is also re-evaluated at least that often, without being notified */
+static int hades_waitable_block(hades_waitable* const w, int(*predicate)(void*), void* ctx, int timeout_ms, int poll_ms)
+{
+    int satisfied;
+#ifdef _WIN32
+    ULONGLONG deadline, now;
+    DWORD sleep_ms;
+#else
+    struct timespec ts, deadline;
+#endif
+
+    /* Note: the waiter is counted before the predicate is evaluated under the lock, and notifiers change the state
+     * before checking the count (both sequentially consistent); so either this sees the new state, or the notifier
+     * sees the waiter, and then takes the lock, which it can only get once this is asleep */
+#ifdef _WIN32
+    deadline = GetTickCount64() + (ULONGLONG)SAF_MAX(timeout_ms, 0);
+    AcquireSRWLockExclusive(&w->lock);
+    atomic_fetch_add(&w->nWaiters, 1);
+    while(!(satisfied = predicate(ctx))){
+        sleep_ms = INFINITE;
+        if(timeout_ms>=0){
+            now = GetTickCount64();
+            if(now>=deadline)
+                break;
+            sleep_ms = (DWORD)(deadline-now);
+        }
+        if(poll_ms>0 && (sleep_ms==INFINITE || sleep_ms>(DWORD)poll_ms))
+            sleep_ms = (DWORD)poll_ms;
+        SleepConditionVariableSRW(&w->cond, &w->lock, sleep_ms, 0);
+    }
+    atomic_fetch_sub(&w->nWaiters, 1);
+    ReleaseSRWLockExclusive(&w->lock);
+#else
+    timespec_get(&deadline, TIME_UTC); /* (same clock as pthread_cond_timedwait) */
+    hades_timespec_addMs(&deadline, SAF_MAX(timeout_ms, 0));
+    pthread_mutex_lock(&w->lock);
+    atomic_fetch_add(&w->nWaiters, 1);
+    while(!(satisfied = predicate(ctx))){
+        if(timeout_ms<0 && poll_ms<=0){
+            pthread_cond_wait(&w->cond, &w->lock);
+            continue;
+        }
+        timespec_get(&ts, TIME_UTC);
+        if(timeout_ms>=0 && !hades_timespec_isBefore(&ts, &deadline))
+            break;
+        if(poll_ms>0){
+            hades_timespec_addMs(&ts, poll_ms);
+            if(timeout_ms>=0 && hades_timespec_isBefore(&deadline, &ts))
+                ts = deadline;
+        }
+        else
+            ts = deadline;
+        pthread_cond_timedwait(&w->cond, &w->lock, &ts);
+    }
+    atomic_fetch_sub(&w->nWaiters, 1);
+    pthread_mutex_unlock(&w->lock);
+#endif
+    return satisfied;
+}
+
+void hades_waitable_wait(hades_waitable* const w, int(*predicate)(void*), void* ctx)
+{
+    /* Fast path */
+    if(predicate(ctx))
+        return;
+    hades_waitable_block(w, predicate, ctx, -1, 0);
+}
+
+int hades_waitable_waitForProcessing(hades_waitable* const w, int(*predicate)(void*), void* ctx, int timeout_ms)
+{
+    int satisfied, watched;
+
+    /* Fast path */
+    if(predicate(ctx))
+        return 1;
+    if(timeout_ms==0)
+        return 0;
+
+    /* (without the post service, the posts are never turned into notifications, so the predicate is polled instead) */
+    watched = hades_post_service_watch(w);
+    satisfied = hades_waitable_block(w, predicate, ctx, timeout_ms, watched ? 0 : POST_SERVICE_POLL_MS);
+    if(watched)
+        hades_post_service_unwatch(w);
+    return satisfied;
+}
+
+void hades_waitable_notify(hades_waitable* const w)
+{
+    /* (the fence orders the caller's state change before the count is checked, see hades_waitable_block()) */
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load(&w->nWaiters) > 0){
+#ifdef _WIN32
+        AcquireSRWLockExclusive(&w->lock);
+        WakeAllConditionVariable(&w->cond);
+        ReleaseSRWLockExclusive(&w->lock);
+#else
+        pthread_mutex_lock(&w->lock);
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+#endif
+    }
+}
+
+void hades_waitable_post(hades_waitable* const w)
+{
+    /* (the post service forwards it within POST_SERVICE_POLL_MS; nothing here may block, or enter the kernel) */
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load(&w->nWaiters) > 0)
+        atomic_store(&w->posted, 1);
+}
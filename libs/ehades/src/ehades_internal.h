@@ -38,6 +38,21 @@
 #include <math.h>
 #include <string.h>
 #include <float.h>
+#include <stdint.h>
+#include <time.h>
+#include <stdatomic.h>
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <pthread.h>
+# include <sched.h>
+# include <sys/resource.h>
+# ifdef __APPLE__
+#  include <dispatch/dispatch.h>
+# else
+#  include <semaphore.h>
+# endif
+#endif
 #include "ehades.h"
 #include "saf.h"
 #include "saf_externals.h"
@@ -46,57 +61,323 @@
 extern "C" {
 #endif /* __cplusplus */
 
-/**
- * Current status of the processing loop
- *
- * These are used to keep things thread-safe. i.e., the codec will not be
- * initialised if the currently configured codec is being used to process a
- * block of audio. Likewise, if the codec is being initialised, then the
- * "process" functions are bypassed.
- */
-typedef enum {
-    PROC_STATUS_ONGOING = 0, /**< Codec is processing input audio, and should
-                              *   not be reinitialised at this time. */
-    PROC_STATUS_NOT_ONGOING  /**< Codec is not processing input audio, and may
-                              *   be reinitialised if needed. */
-}PROC_STATUS;
-
-
 /* ========================================================================== */
 /*                            Internal Parameters                             */
 /* ========================================================================== */
 
-#ifndef FRAME_SIZE
-# define FRAME_SIZE ( 1024 )
+#ifndef MAX_FRAME_SIZE
+# define MAX_FRAME_SIZE ( 1024 )
 #endif
 #define MAX_NUM_SH_SIGNALS ( (MAX_SH_ORDER + 1)*(MAX_SH_ORDER + 1)  )    /* (L+1)^2 */
 #define HOP_SIZE ( 128 )
-#if (FRAME_SIZE % HOP_SIZE != 0)
-# error "FRAME_SIZE must be an integer multiple of HOP_SIZE"
+#define DEFAULT_FRAME_SIZE ( MAX_FRAME_SIZE )
+#if (MAX_FRAME_SIZE % HOP_SIZE != 0)
+# error "MAX_FRAME_SIZE must be an integer multiple of HOP_SIZE"
 #endif 
+#define DEFAULT_AVERAGING_COEFF ( 0.77f )  /* Default analysis/synthesis averaging coefficient, for blocks of MAX_FRAME_SIZE */
+#define SILENCE_GATE_THRESHOLD ( 1e-12f )  /* Mean input power (over samples), below which a frame is considered silent (-120 dBFS) */
+#define FADE_SOURCE_POLL_MS ( 20 )         /* How often the initialisation service checks whether a crossfade has finished */
+#define POST_SERVICE_POLL_MS ( 1 )         /* How often the post service forwards the processing loop's posts, while a thread waits on them */
+#define DEFAULT_CACHE_SIZE_LIMIT_MB ( 1024 ) /* Default size limit of the on-disk IR cache */
 
 /* ========================================================================== */
 /*                                 Structures                                 */
 /* ========================================================================== */
 
+/**
+ * Wait/notify primitive, used to block the control threads (e.g. while waiting
+ * for an initialisation to finish) instead of polling
+ *
+ * Only the control threads ever wait on it. They notify it under its lock, so
+ * that no notification is ever missed. The processing loop must neither take
+ * the lock nor make a system call, and so it only posts it instead: this just
+ * raises 'posted', which the post service (a process-wide background thread)
+ * turns into a notification, while a thread is waiting on it.
+ */
+typedef struct _hades_waitable {
+#ifdef _WIN32
+    SRWLOCK lock;                            /**< Lock associated with 'cond' */
+    CONDITION_VARIABLE cond;                 /**< Condition variable */
+#else
+    pthread_mutex_t lock;                    /**< Lock associated with 'cond' */
+    pthread_cond_t cond;                     /**< Condition variable */
+#endif
+    atomic_int nWaiters;                     /**< Number of threads currently waiting */
+    atomic_int posted;                       /**< 1: posted by the processing loop since the post service last looked */
+    int nWatchers;                           /**< Number of waiting threads that asked the post service to watch it (post service lock) */
+    struct _hades_waitable* nextWatched;     /**< Next waitable watched by the post service (post service lock) */
+} hades_waitable;
+
+/** Mutex, for short critical sections on the control threads only */
+typedef struct _hades_mutex {
+#ifdef _WIN32
+    SRWLOCK lock;                            /**< Slim reader/writer lock (used exclusively) */
+#else
+    pthread_mutex_t lock;                    /**< Mutex */
+#endif
+} hades_mutex;
+
+/**
+ * Counting semaphore, which parks the worker threads between batches
+ *
+ * Posting it never blocks, and only enters the kernel if a thread is parked
+ * on it (except on Windows), so the processing loop may post it.
+ */
+typedef struct _hades_semaphore {
+#if defined(_WIN32)
+    HANDLE sem;                              /**< Semaphore object */
+#elif defined(__APPLE__)
+    dispatch_semaphore_t sem;                /**< Dispatch semaphore (unnamed POSIX semaphores are not supported) */
+#else
+    sem_t sem;                               /**< POSIX semaphore */
+#endif
+} hades_semaphore;
+
+/**
+ * Long-lived background thread, which (re)initialises the codec whenever it
+ * is requested to
+ *
+ * Requests that arrive while an initialisation is under way are coalesced into
+ * one further initialisation, which picks up all of the settings changes made
+ * in the meantime.
+ */
+typedef struct _hades_init_service {
+    void* hHdR;                              /**< hades_renderer handle */
+#ifdef _WIN32
+    HANDLE thread;                           /**< Initialisation thread */
+    SRWLOCK lock;                            /**< Guards 'requested' and 'quit' */
+    CONDITION_VARIABLE cond;                 /**< Signalled when 'requested' or 'quit' are set */
+#else
+    pthread_t thread;                        /**< Initialisation thread */
+    pthread_mutex_t lock;                    /**< Guards 'requested' and 'quit' */
+    pthread_cond_t cond;                     /**< Signalled when 'requested' or 'quit' are set */
+#endif
+    int requested;                           /**< 1: an initialisation has been requested since the thread last woke */
+    int quit;                                /**< 1: the thread should exit */
+} hades_init_service;
+
+/**
+ * One task of an initialisation (e.g. converting an IR set), and the portion
+ * of the progress bar that it covers; may be advanced from several threads
+ */
+typedef struct _hades_progress {
+    _Atomic(float)* bar;                     /**< Progress bar value [0..1] to update */
+    float start;                             /**< Progress bar value at the start of the task */
+    float span;                              /**< Portion of the progress bar covered by the task */
+    int nTotal;                              /**< Number of items (e.g. directions) in the task */
+    atomic_int nDone;                        /**< Number of items done so far */
+} hades_progress;
+
+/** Maximum number of jobs per worker pool batch */
+#define MAX_NUM_POOL_JOBS ( 8 )
+
+/** A job, as run by the worker pool */
+typedef void(*hades_job_fn)(void* arg);
+
+/**
+ * Pool of worker threads, which the processing loop can hand jobs to
+ *
+ * Jobs are posted in batches by a single thread (the processing loop), which
+ * then runs any that the workers have not claimed yet, before spinning until
+ * those claimed by the workers have finished; it never blocks. Jobs are
+ * claimed with a compare-exchange on 'claim', which holds both the batch ID
+ * and the index of the next job, so workers that are late to a batch can never
+ * claim jobs from the next one. Nothing is allocated by the posting thread.
+ *
+ * Idle workers spin briefly, and then park on 'wake', which the posting thread
+ * only posts if 'nParked' says that a worker is parked.
+ */
+typedef struct _hades_worker_pool {
+    int nThreads;                            /**< Number of worker threads */
+#ifdef _WIN32
+    HANDLE* threads;                         /**< Worker threads; nThreads x 1 */
+#else
+    pthread_t* threads;                      /**< Worker threads; nThreads x 1 */
+#endif
+    struct _hades_worker_ctx* workers;       /**< Per-worker state; nThreads x 1 */
+    hades_semaphore wake;                    /**< Posted when a batch is posted to parked workers, or the pool is quitting */
+    atomic_int nParked;                      /**< Number of workers parked (or about to park) on 'wake' */
+    atomic_int quit;                         /**< 1: worker threads should exit */
+    atomic_uint claim;                       /**< Batch ID (upper bits) and index of the next job to claim (lower 8 bits) */
+    atomic_int nJobs;                        /**< Number of jobs in the current batch */
+    atomic_int nDone;                        /**< Number of jobs in the current batch that have finished */
+    unsigned int batchId;                    /**< ID of the most recently posted batch (posting thread only) */
+    hades_job_fn jobFn[MAX_NUM_POOL_JOBS];   /**< Job functions of the current batch */
+    void* jobArg[MAX_NUM_POOL_JOBS];         /**< Job arguments of the current batch */
+} hades_worker_pool;
+
+/**
+ * Flags for the parts of the codec that need to be rebuilt upon the next
+ * initialisation (see hades_renderer_markDirty())
+ */
+typedef enum {
+    STAGE_MAIR_SET   = 1<<0,                 /**< Microphone array IRs; implies STAGE_ANALYSIS */
+    STAGE_HRIR_SET   = 1<<1,                 /**< HRIRs; implies STAGE_SYNTHESIS */
+    STAGE_ANALYSIS   = 1<<2,                 /**< Analysis and radial editor; implies STAGE_CONTAINERS and STAGE_SYNTHESIS */
+    STAGE_CONTAINERS = 1<<3,                 /**< Parameter/signal containers */
+    STAGE_SYNTHESIS  = 1<<4,                 /**< Synthesis */
+    STAGE_ALL        = (1<<5)-1
+} HADES_CODEC_STAGES;
+
+/**
+ * Analysis stage of a codec generation (the radial editor is included, as it
+ * is built from, and sized by, the analysis)
+ *
+ * Stages are reference-counted, so that a new generation can reuse those that
+ * are unaffected by a settings change. A stage is only ever run once per frame,
+ * even while it is shared by the incoming and outgoing generations.
+ */
+typedef struct _hades_analysis_stage {
+    atomic_int refCount;                     /**< Number of generations using the stage */
+    hades_analysis_handle hAna;              /**< Analysis handle */
+    hades_radial_editor_handle hREd;         /**< Parameter radial editor handle */
+} hades_analysis_stage;
+
+/** Parameter/signal containers stage of a codec generation */
+typedef struct _hades_container_stage {
+    atomic_int refCount;                     /**< Number of generations using the stage */
+    int pipelined;                           /**< 1: there is a second set of containers (hPConPipe/hSConPipe), 0: there is not */
+    hades_param_container_handle hPCon;      /**< Parameter Container handle */
+    hades_signal_container_handle hSCon;     /**< Signal Container handle */
+    hades_param_container_handle hPConPipe;  /**< Parameter Container being written by the analysis, when pipelined; NULL otherwise */
+    hades_signal_container_handle hSConPipe; /**< Signal Container being written by the analysis, when pipelined; NULL otherwise */
+} hades_container_stage;
+
+/** Synthesis stage of a codec generation */
+typedef struct _hades_synthesis_stage {
+    atomic_int refCount;                     /**< Number of generations using the stage */
+    hades_synthesis_handle hSyn;             /**< Synthesis handle */
+} hades_synthesis_stage;
+
+/**
+ * One complete set of codec objects (a "codec generation")
+ *
+ * A new generation is built by hades_renderer_initCodec() while the processing
+ * loop keeps using the current one. It is then published with a single atomic
+ * pointer swap, and the previous generation is destroyed once the processing
+ * loop is no longer using it. Any stages that were not affected by the
+ * settings change are shared with the previous generation, rather than
+ * rebuilt.
+ *
+ * Threading: the analysis (hAna, hREd) and the synthesis (hSyn) objects each
+ * own their filterbanks and scratch buffers; the synthesis copies what it
+ * needs from the analysis when it is created, and never touches the analysis
+ * object again. The only memory the two stages share is the container pair
+ * that the analysis writes and the synthesis reads. Therefore, a generation
+ * may be analysed and synthesised at the same time, provided that the two
+ * calls are given different containers (see 'hPConPipe'/'hSConPipe'), and
+ * that the analysis does not read from the synthesis output.
+ */
+typedef struct _hades_codec_generation {
+    hades_analysis_stage* ana;               /**< Analysis stage */
+    hades_container_stage* con;              /**< Container stage */
+    hades_synthesis_stage* syn;              /**< Synthesis stage */
+    hades_analysis_handle hAna;              /**< Analysis handle (ana->hAna) */
+    hades_radial_editor_handle hREd;         /**< Parameter radial editor handle (ana->hREd) */
+    hades_synthesis_handle hSyn;             /**< Synthesis handle (syn->hSyn) */
+    int nMics;                               /**< Number of microphones the analysis was configured for */
+    int frameSize;                           /**< Frame size the analysis/synthesis were configured for, in samples */
+    unsigned int id;                         /**< Unique (incrementing) generation ID */
+    hades_worker_pool* hPool;                /**< Worker pool (one thread); created if pipelined, or if crossfades are enabled; NULL otherwise */
+
+    /* Crossfade from the previous generation */
+    _Atomic(struct _hades_codec_generation*) fadeFrom; /**< Outgoing generation to crossfade from; NULL if none */
+    int nFadeFrames;                         /**< Total number of frames in which 'fadeFrom' is also processed */
+    int nFadeWarmupFrames;                   /**< Number of those frames in which only 'fadeFrom' is heard, while the new filterbanks fill */
+    atomic_int fadeFinished;                 /**< Set by the processing loop once it has finished with 'fadeFrom' */
+} hades_codec_generation;
+
+/**
+ * A set of measured impulse responses (microphone array IRs or HRIRs), loaded
+ * either from a SOFA file, or from the on-disk cache
+ */
+typedef struct _hades_ir_set {
+    int nDirs;                               /**< Number of measurement directions */
+    int nCh;                                 /**< Number of channels (microphones/ears) per direction */
+    int IRlength;                            /**< Length of IRs, in samples */
+    float IR_fs;                             /**< Sample rate of the IRs (the host sample rate, if they were converted) */
+    float sourceFs;                          /**< Sample rate used for measuring the IRs */
+    float* dirs_deg;                         /**< Measurement directions [azi elev], in degrees; FLAT: nDirs x 2 */
+    float* IRs;                              /**< Impulse responses; FLAT: nDirs x nCh x IRlength */
+    void* mapping;                           /**< Memory-mapped cache file that the arrays point into; NULL if they were allocated */
+    size_t mappingSize;                      /**< Size of 'mapping', in bytes */
+} hades_ir_set;
+
+/**
+ * Load-time reduction of an IR set (see hades_ir_set_truncate() and
+ * hades_ir_set_decimate()); all zeros: none
+ */
+typedef struct _hades_ir_reduction {
+    int32_t truncate;                        /**< 1: leading/trailing near-silence is trimmed from the IRs, 0: not */
+    int32_t targetNumDirs;                   /**< Number of directions to decimate the grid to; 0: all are kept */
+    float maxSteeringError_dB;               /**< Steering-vector error bound of the decimation, in dB (0 if it is disabled) */
+} hades_ir_reduction;
+
+/**
+ * Identifies an on-disk cache entry: what the IR set was loaded from, and how
+ * it was converted upon loading (only what affects the stored IRs, so that
+ * codecs differing in their filterbank configuration share the same entry)
+ *
+ * @note Compared bytewise, so must be zero-initialised (padding included)
+ */
+typedef struct _hades_ir_cache_key {
+    uint64_t sourceHash;                     /**< 64-bit hash of the SOFA file contents (see hades_ir_set_hashFile()) */
+    float fs;                                /**< Host sample rate (which the IRs are converted to) */
+    hades_ir_reduction reduction;            /**< Reduction applied upon loading */
+} hades_ir_cache_key;
+
+/** Arguments for applying a codec generation to a frame, as a worker pool job */
+typedef struct _hades_apply_job {
+    hades_codec_generation* gen;             /**< Codec generation */
+    float** inFrame;                         /**< Input frame; gen->nMics x gen->frameSize */
+    float* dirGain_dB;                       /**< Radial editor gains; 360 x 1 */
+    float** outFrame;                        /**< Output frame; NUM_EARS x gen->frameSize */
+} hades_apply_job;
+
 /** Main structure for hades_renderer */
 typedef struct _hades_renderer {
+    /* FIFO buffers */
+    int FIFO_idx;                            /**< FIFO buffer index */
+    float** inFIFO;                          /**< Input FIFO buffer; HADES_MAX_NUM_INPUTS x MAX_FRAME_SIZE */
+    float** outFIFO;                         /**< Output FIFO buffer; NUM_EARS x MAX_FRAME_SIZE */
+
+    /* Crossfading (owned by the processing loop) */
+    unsigned int fadeGenId;                  /**< ID of the codec generation last processed */
+    int fadeFrameIdx;                        /**< Number of frames processed since that generation was picked up */
+    float** fadeFrameTD;                     /**< Output of the outgoing generation; NUM_EARS x MAX_FRAME_SIZE */
+    float** newFrameTD;                      /**< Output of the incoming generation, when run in parallel; NUM_EARS x MAX_FRAME_SIZE */
+    float** pipeInFrameTD;                   /**< Copy of the input frame read by the pipelined analysis; HADES_MAX_NUM_INPUTS x MAX_FRAME_SIZE */
+    hades_apply_job applyJobs[2];            /**< Worker pool jobs for the outgoing and incoming generations */
+
+    /* Frame-based processing */
+    float* zeroFrame;                        /**< Zeros, read in place of missing input channels; MAX_FRAME_SIZE x 1 */
+    float** discardFrameTD;                  /**< Written in place of missing output channels; NUM_EARS x MAX_FRAME_SIZE */
+
+    /* Silence gate (owned by the processing loop) */
+    int silentSamples;                       /**< Number of consecutive silent input samples */
+    int isGated;                             /**< 1: the codec is currently bypassed due to silence, 0: it is not */
+
     /* audio buffers and afSTFT stuff */
-    float** inputFrameTD;                    /**< Input frame; nInputs x FRAME_SIZE */ 
-    float** outputFrameTD;                   /**< Output frame; nOutputs x FRAME_SIZE */
     float fs;                                /**< Sampling rate */
 
     /* Internal */
     int MAIR_SOFA_isLoadedFLAG;              /**< 0: no MAIR SOFA file has been loaded, so do not render audio; 1: SOFA file HAS been loaded */
-    hades_analysis_handle hAna;              /**< Analysis handle */
-    hades_synthesis_handle hSyn;             /**< Synthesis handle */
-    hades_param_container_handle hPCon;      /**< Parameter Container handle */
-    hades_signal_container_handle hSCon;     /**< Signal Container handle */
-    hades_radial_editor_handle hREd;         /**< Parameter radial editor handle */
-    HADES_CODEC_STATUS codecStatus;          /**< see #HADES_CODEC_STATUS */
-    float progressBar0_1;                    /**< Progress bar value [0..1] */
+    _Atomic(hades_codec_generation*) codecGen; /**< Most recently published codec generation; NULL if there is none */
+    _Atomic(hades_codec_generation*) procGen;  /**< Codec generation being used by the processing loop; NULL if not processing */
+    _Atomic(hades_codec_generation*) ctrlGen;  /**< Codec generation being used by a get/set function; NULL if none */
+    hades_mutex ctrlLock;                    /**< Serialises the users of 'ctrlGen' (there is only one such slot) */
+    hades_mutex retireLock;                  /**< Guards the publishing of codec generations against hades_renderer_collectFadeSource() */
+    _Atomic(HADES_CODEC_STATUS) codecStatus; /**< see #HADES_CODEC_STATUS */
+    hades_waitable statusChanged;            /**< Notified whenever 'codecStatus' or 'ctrlGen' change, and posted whenever 'procGen' or a 'fadeFinished' flag do */
+    unsigned int genCounter;                 /**< Number of codec generations created so far */
+    atomic_int dirtyStages;                  /**< Stages to rebuild upon the next initialisation; see #HADES_CODEC_STAGES */
+    atomic_int cancelInit;                   /**< Set to 1 to ask the current initialisation to stop (cleared once it has) */
+    hades_init_service* initService;         /**< Background initialisation thread; NULL if not started */
+    hades_mutex pathLock;                    /**< Guards the file/directory path strings */
+    _Atomic(float) progressBar0_1;           /**< Progress bar value [0..1] */
+    hades_mutex profileLock;                 /**< Guards 'initProfile' */
+    hades_renderer_init_profile initProfile; /**< Profile of the last completed initialisation */
     char* progressBarText;                   /**< Progress bar text; HADES_PROGRESSBARTEXT_CHAR_LENGTH x 1*/
-    PROC_STATUS procStatus;                  /**< see #_PROC_STATUS */
 
     /* Local copy of internal parameter vectors (for optional thread-safe GUI plotting) */
     int nBands_local;                        /**< Number of bands used for plotting */
@@ -110,19 +391,30 @@ typedef struct _hades_renderer {
     /* IR data */
     int nMics;                               /**< Number of microphones/hydrophones in the array */
     int nDirs;                               /**< Number of measurement directions/IRs */
-    int IRlength;                            /**< Length of IRs, in samples */
+    int IRlength;                            /**< Length of IRs, in samples (after conversion to the host sample rate) */
     float IR_fs;                             /**< Sample rate used for measuring the IRs */
+    float HRIR_fs;                           /**< Sample rate used for measuring the HRIRs */
 
     /* user parameters */
-    hades_binaural_config binConfig;         /**< Binaural configuration settings */
-    char* sofa_filepath_MAIR;                /**< microphone array IRs; absolute/relevative file path for a sofa file */
+    hades_binaural_config binConfig;         /**< Binaural configuration settings (views of 'hrirSet') */
+    hades_ir_set* mairSet;                   /**< Microphone array IRs (from the registry); NULL if none are loaded */
+    hades_ir_set* hrirSet;                   /**< HRIRs, or the default HRIRs (from the registry); NULL if none are loaded */
+    char* sofa_filepath_MAIR;                /**< microphone array IRs; absolute/relevative file path for a sofa file (see 'pathLock') */
     int useDefaultHRIRsFLAG;                 /**< 0: use specified sofa file, 1: use default HRIR set */
-    char* sofa_filepath_HRIR;                /**< HRIRs; absolute/relevative file path for a sofa file */
+    char* sofa_filepath_HRIR;                /**< HRIRs; absolute/relevative file path for a sofa file (see 'pathLock') */
+    char* cacheDirectory;                    /**< Directory for the on-disk IR cache; NULL: caching is disabled (see 'pathLock') */
+    int cacheSizeLimit_MB;                   /**< Size limit of the on-disk IR cache, in MB; 0: none (see 'pathLock') */
+    hades_ir_reduction mairReduction;        /**< Reduction of the microphone array IRs upon loading (see 'pathLock') */
     int refsensor_idx[2];                    /**< Indices defining the left 0 and right 1 reference sensors */
     HADES_RENDERER_DIFFUSENESS_ESTIMATORS diffOption; /**< see #HADES_RENDERER_DIFFUSENESS_ESTIMATORS */
     HADES_RENDERER_DOA_ESTIMATORS doaOption; /**< see #HADES_RENDERER_DOA_ESTIMATORS */
     HADES_RENDERER_BEAMFORMER_TYPE beamOption; /**< see #HADES_RENDERER_BEAMFORMER_TYPE */
+    HADES_RENDERER_HRTF_INTERP_OPTIONS interpOption; /**< see #HADES_RENDERER_HRTF_INTERP_OPTIONS */
     int enableCovMatching;                   /**< 0: disabled; 1: spatial covariance matching is enabled */
+    int frameSize;                           /**< Processing frame size, in samples; multiple of HOP_SIZE, and no larger than MAX_FRAME_SIZE */
+    int crossfadeFrames;                     /**< Crossfade length after reinitialisation, in frames; 0: disabled */
+    int enableSilenceGate;                   /**< 1: the codec is bypassed while the input is silent, 0: always processed */
+    int enablePipelining;                    /**< 1: analysis of each frame overlaps with synthesis of the previous one, 0: serial */
     
 } hades_renderer_data;
 
@@ -132,13 +424,582 @@ typedef struct _hades_renderer {
 /* ========================================================================== */
   
 /**
- * Sets codec status.
+ * Flags parts of the codec as needing to be rebuilt, and sets the codec status
+ * to #CODEC_STATUS_NOT_INITIALISED
  *
- * @param[in] hHdR      hades_renderer handle
- * @param[in] newStatus Codec status (see #HADES_CODEC_STATUS enum)
+ * This never waits for an initialisation that is under way; it is instead
+ * asked to stop (see hades_renderer_isInitCancelled()), after which it flags
+ * the codec as not initialised itself. Either way, the initialisation service
+ * (if started) is then requested to reinitialise the codec.
+ *
+ * @param[in] hHdR   hades_renderer handle
+ * @param[in] stages Stages affected by the settings change; see
+ *                   #HADES_CODEC_STAGES
  */
-void hades_renderer_setCodecStatus(void* const hHdR,
-                                   HADES_CODEC_STATUS newStatus);
+void hades_renderer_markDirty(void* const hHdR,
+                              int stages);
+
+/**
+ * Destroys a codec generation once the processing loop is no longer using it
+ *
+ * Any generation that it was still crossfading from is destroyed too.
+ *
+ * @note Must not be called from the processing loop. The generation must have
+ *       already been unpublished (i.e., swapped out of 'codecGen').
+ *
+ * @param[in] hHdR  hades_renderer handle
+ * @param[in] phGen (&) address of the codec generation to destroy
+ */
+void hades_renderer_retireCodecGeneration(void* const hHdR,
+                                          hades_codec_generation** const phGen);
+
+/**
+ * Destroys the generation that 'gen' is crossfading from, once the processing
+ * loop no longer needs it
+ *
+ * This waits until either the crossfade has finished, or 'gen' is no longer in
+ * use (i.e., it was unpublished and the processing loop has moved on). If
+ * neither happens within 'timeout_ms' (e.g., because audio is not currently
+ * being processed), then the outgoing generation is left for a later call.
+ *
+ * @note Must not be called from the processing loop
+ *
+ * @param[in] hHdR       hades_renderer handle
+ * @param[in] gen        Codec generation
+ * @param[in] timeout_ms Maximum time to wait, in milliseconds; negative: no limit
+ */
+void hades_renderer_releaseFadeSource(void* const hHdR,
+                                      hades_codec_generation* const gen,
+                                      int timeout_ms);
+
+/**
+ * Destroys the generation that the current one is crossfading from, if the
+ * processing loop no longer needs it (never waits)
+ *
+ * Called by the initialisation service, so that initialisations need not wait
+ * for the crossfade to finish.
+ *
+ * @param[in] hHdR hades_renderer handle
+ * @returns 1 if there is still an outgoing generation to destroy, 0 otherwise
+ */
+int hades_renderer_collectFadeSource(void* const hHdR);
+
+/**
+ * Flags the current codec generation as in use by the processing loop (so that
+ * it is not destroyed), and returns it (NULL if there is none)
+ *
+ * Must be paired with hades_renderer_releaseCodecGeneration().
+ */
+hades_codec_generation* hades_renderer_acquireCodecGeneration(void* const hHdR);
+
+/** Flags that the processing loop is no longer using a codec generation */
+void hades_renderer_releaseCodecGeneration(void* const hHdR);
+
+/**
+ * As hades_renderer_acquireCodecGeneration(), but for the get/set functions
+ * (i.e., threads other than the processing loop) that access the codec
+ *
+ * These calls are serialised, and so the generation should only be held for
+ * as long as it takes to read or write a value. Must be paired with
+ * hades_renderer_releaseControlGeneration().
+ */
+hades_codec_generation* hades_renderer_acquireControlGeneration(void* const hHdR);
+
+/** Flags that a get/set function is no longer using a codec generation */
+void hades_renderer_releaseControlGeneration(void* const hHdR);
+
+/**
+ * Processes one frame with the given codec generation, including any
+ * crossfade from the generation it replaced, and the silence gate
+ *
+ * @note Processing loop only. 'inFrame' and 'outFrame' may share memory.
+ *
+ * @param[in]  hHdR     hades_renderer handle
+ * @param[in]  gen      Codec generation, acquired via
+ *                      hades_renderer_acquireCodecGeneration()
+ * @param[in]  inFrame  Input frame; gen->nMics x gen->frameSize
+ * @param[out] outFrame Output frame; NUM_EARS x gen->frameSize
+ */
+void hades_renderer_processCodecFrame(void* const hHdR,
+                                      hades_codec_generation* const gen,
+                                      float** inFrame,
+                                      float** outFrame);
+
+/** Applies a codec generation to a frame (#hades_job_fn taking a #hades_apply_job) */
+void hades_codec_generation_applyJob(void* arg);
+
+/** Analyses a frame with a codec generation (#hades_job_fn taking a #hades_apply_job) */
+void hades_codec_generation_analyseJob(void* arg);
+
+/** Synthesises a frame with a codec generation (#hades_job_fn taking a #hades_apply_job) */
+void hades_codec_generation_synthesiseJob(void* arg);
+
+/**
+ * Creates a pool of worker threads
+ *
+ * @param[in] phPool   (&) address of the worker pool
+ * @param[in] nThreads Number of worker threads to spawn
+ */
+void hades_worker_pool_create(hades_worker_pool** const phPool,
+                              int nThreads);
+
+/** Stops and joins the worker threads, and frees the worker pool */
+void hades_worker_pool_destroy(hades_worker_pool** const phPool);
+
+/**
+ * Posts a batch of jobs to the worker pool, which the workers start on
+ * immediately
+ *
+ * @note Must be followed by hades_worker_pool_join(), before the next batch
+ *       is posted. Never blocks.
+ *
+ * @param[in] hPool worker pool
+ * @param[in] fns   Job functions; nJobs x 1
+ * @param[in] args  Job arguments; nJobs x 1
+ * @param[in] nJobs Number of jobs, up to MAX_NUM_POOL_JOBS
+ */
+void hades_worker_pool_post(hades_worker_pool* const hPool,
+                            const hades_job_fn* fns,
+                            void* const* args,
+                            int nJobs);
+
+/**
+ * Runs any jobs of the current batch that have not yet been claimed, and then
+ * waits until all of them have finished
+ *
+ * The wait only ever spins (yielding the CPU after a while), as the remaining
+ * jobs are already being run by the workers. Never blocks on a lock.
+ */
+void hades_worker_pool_join(hades_worker_pool* const hPool);
+
+/**
+ * Applies the analysis and radial editor of a codec generation to one frame
+ *
+ * When pipelined, the results are written to the containers that are
+ * synthesised after the next call to hades_codec_generation_swapContainers().
+ *
+ * @param[in] gen        Codec generation
+ * @param[in] inFrame    Input frame; gen->nMics x gen->frameSize
+ * @param[in] dirGain_dB Radial editor gains; 360 x 1
+ */
+void hades_codec_generation_analyse(hades_codec_generation* const gen,
+                                    float** inFrame,
+                                    float* dirGain_dB);
+
+/**
+ * Applies the synthesis of a codec generation to one frame
+ *
+ * @param[in]  gen      Codec generation
+ * @param[out] outFrame Output frame; NUM_EARS x gen->frameSize
+ */
+void hades_codec_generation_synthesise(hades_codec_generation* const gen,
+                                       float** outFrame);
+
+/** Swaps the analysed and synthesised sets of containers (if pipelined) */
+void hades_codec_generation_swapContainers(hades_codec_generation* const gen);
+
+/**
+ * Returns the delay of a codec generation, in samples (not including the FIFO
+ * buffering)
+ */
+int hades_codec_generation_getDelay(hades_codec_generation* const gen);
+
+/**
+ * Applies the analysis, radial editor and synthesis of a codec generation to
+ * one frame
+ *
+ * @param[in]  gen      Codec generation
+ * @param[in]  inFrame  Input frame; gen->nMics x gen->frameSize
+ * @param[in]  dirGain_dB Radial editor gains; 360 x 1
+ * @param[out] outFrame Output frame; NUM_EARS x gen->frameSize
+ */
+void hades_codec_generation_apply(hades_codec_generation* const gen,
+                                  float** inFrame,
+                                  float* dirGain_dB,
+                                  float** outFrame);
+
+/** Blocks the calling (control) thread until the codec is not initialising */
+void hades_renderer_waitWhileInitialising(void* const hHdR);
+
+/**
+ * Returns 1 if the current initialisation should stop, as the settings have
+ * changed since it started (checked by hades_renderer_initCodec() between
+ * stages), 0 otherwise
+ */
+int hades_renderer_isInitCancelled(void* const hHdR);
+
+/**
+ * Destroys a codec generation that was never published (e.g., one abandoned
+ * part of the way through being built, in which case any stages that were not
+ * yet assigned must be NULL)
+ */
+void hades_codec_generation_discard(hades_codec_generation** const phGen);
+
+/**
+ * Starts an initialisation service thread, which runs at a lower priority than
+ * the calling thread where the platform allows
+ *
+ * @returns 1 if the thread was started, 0 otherwise (*phSvc is then NULL)
+ */
+int hades_init_service_create(hades_init_service** const phSvc,
+                              void* const hHdR);
+
+/** Stops and joins the initialisation service thread, and frees it */
+void hades_init_service_destroy(hades_init_service** const phSvc);
+
+/** Requests that the service (re)initialises the codec as soon as possible */
+void hades_init_service_request(hades_init_service* const hSvc);
+
+/** Initialises a mutex */
+void hades_mutex_create(hades_mutex* const m);
+
+/** Frees the resources of a mutex */
+void hades_mutex_destroy(hades_mutex* const m);
+
+/** Locks a mutex (never from the processing loop) */
+void hades_mutex_lock(hades_mutex* const m);
+
+/** Unlocks a mutex */
+void hades_mutex_unlock(hades_mutex* const m);
+
+/** Initialises a semaphore, with a count of zero */
+void hades_semaphore_create(hades_semaphore* const s);
+
+/** Frees the resources of a semaphore */
+void hades_semaphore_destroy(hades_semaphore* const s);
+
+/** Blocks until the count is non-zero, and then decrements it (never from the processing loop) */
+void hades_semaphore_wait(hades_semaphore* const s);
+
+/** Increments the count by 'n', waking up as many parked threads. Never blocks */
+void hades_semaphore_post(hades_semaphore* const s,
+                          int n);
+
+/**
+ * Starts a progress task: 'nTotal' items, covering [start, start+span] of the
+ * progress bar (which is not touched if 'p' or its 'bar' are NULL)
+ */
+void hades_progress_begin(hades_progress* const p,
+                          int nTotal);
+
+/**
+ * Advances a progress task by 'nItems', and updates the progress bar (which
+ * never moves backwards, even if several threads advance it at once)
+ */
+void hades_progress_advance(hades_progress* const p,
+                            int nItems);
+
+/** Initialises a wait/notify primitive */
+void hades_waitable_create(hades_waitable* const w);
+
+/** Frees the resources of a wait/notify primitive */
+void hades_waitable_destroy(hades_waitable* const w);
+
+/**
+ * Blocks the calling thread until predicate(ctx) returns non-zero
+ *
+ * The predicate is only re-evaluated when the primitive is notified, and so
+ * must only depend on state changed by threads that call
+ * hades_waitable_notify() (see hades_waitable_waitForProcessing() otherwise).
+ *
+ * @warning Must never be called from the processing loop
+ */
+void hades_waitable_wait(hades_waitable* const w,
+                         int(*predicate)(void*),
+                         void* ctx);
+
+/**
+ * Same as hades_waitable_wait(), but for predicates that (also) depend on
+ * state changed by the processing loop, and which gives up after 'timeout_ms'
+ * milliseconds (negative: no limit)
+ *
+ * The post service forwards the processing loop's posts for as long as this
+ * waits, so they wake it up within about POST_SERVICE_POLL_MS.
+ *
+ * @warning Must never be called from the processing loop
+ *
+ * @returns 1: if the predicate was satisfied, 0: if timed out
+ */
+int hades_waitable_waitForProcessing(hades_waitable* const w,
+                                     int(*predicate)(void*),
+                                     void* ctx,
+                                     int timeout_ms);
+
+/**
+ * Wakes up any threads waiting on the primitive (from the control threads)
+ *
+ * This briefly takes the lock, if (and only if) a thread is waiting.
+ *
+ * @warning Must never be called from the processing loop (see
+ *          hades_waitable_post() instead)
+ */
+void hades_waitable_notify(hades_waitable* const w);
+
+/**
+ * Flags the primitive as posted (from the processing loop), so that the post
+ * service wakes up the threads waiting on it
+ *
+ * This is a single atomic store, and only when a thread is waiting.
+ */
+void hades_waitable_post(hades_waitable* const w);
+
+/**
+ * Holds the post service, starting its thread if this is the first holder
+ * (each renderer instance holds it, from creation to destruction)
+ *
+ * If the thread cannot be started, then hades_waitable_waitForProcessing()
+ * re-evaluates its predicate every POST_SERVICE_POLL_MS instead.
+ */
+void hades_post_service_retain(void);
+
+/** Releases the post service, stopping and joining its thread if this was the last holder */
+void hades_post_service_release(void);
+
+/**
+ * Returns a shared IR set for a SOFA file and configuration, loading it only
+ * if no other instance currently holds it
+ *
+ * IR sets are keyed by the file contents, the sample rate and the reduction
+ * only, so instances that differ in any other setting (frame size,
+ * estimators, etc.) still share them. The per-band tables derived from the IRs
+ * are not shared: hades_analysis_create()/hades_synthesis_create() build them
+ * into the same opaque objects as their per-stream state, so each instance
+ * holds its own copy.
+ *
+ * If another thread is already loading the same IR set, then this waits for
+ * it, rather than loading a second copy. The returned IR set must not be
+ * modified, and is released via hades_ir_registry_replace().
+ *
+ * @param[out] phIRs      (&) address of the IR set; NULL on failure
+ * @param[in]  path       SOFA file path
+ * @param[in]  cacheDir   On-disk cache directory; NULL or empty: disabled
+ * @param[in]  cacheSizeLimit Size limit of the cache, in bytes (enforced
+ *                        whenever an entry is added); 0: none
+ * @param[in]  fs         Host sample rate
+ * @param[in]  reduction  Reduction to apply upon loading; NULL: none
+ * @param[in]  progress   Progress of the load, if it is this thread that loads
+ *                        it (converting the IRs advances it per direction);
+ *                        may be NULL
+ * @returns SAF_SOFA_OK if successful, otherwise the SOFA reader error
+ */
+SAF_SOFA_ERROR_CODES hades_ir_registry_acquire(hades_ir_set** const phIRs,
+                                               char* path,
+                                               const char* cacheDir,
+                                               size_t cacheSizeLimit,
+                                               float fs,
+                                               const hades_ir_reduction* reduction,
+                                               hades_progress* const progress);
+
+/**
+ * Returns the shared set of default HRIRs (converted to the host sample rate,
+ * if needed); as hades_ir_registry_acquire(), but never fails
+ */
+void hades_ir_registry_acquireDefaultHRIRs(hades_ir_set** const phIRs,
+                                           float fs,
+                                           hades_progress* const progress);
+
+/**
+ * Stores 'irs' (acquired from the registry, or NULL) in 'slot', and releases
+ * the IR set that was previously stored there (if any)
+ *
+ * The swap is made under the registry lock, so that the slot may be read by
+ * hades_ir_registry_getUsage() from other threads.
+ */
+void hades_ir_registry_replace(hades_ir_set** const slot,
+                               hades_ir_set* const irs);
+
+/**
+ * Sums the memory used by the IR sets held in the given slots (nSlots x 1;
+ * empty slots are skipped), split into what is shared with other holders and
+ * what is held by these slots alone
+ */
+void hades_ir_registry_getUsage(hades_ir_set** const* slots,
+                                int nSlots,
+                                size_t* sharedBytes,
+                                size_t* privateBytes);
+
+/**
+ * Returns the number of IR sets in the registry, the memory they occupy, and
+ * the memory they would occupy if each holder had its own copy
+ */
+void hades_ir_registry_getTotalUsage(int* nSets,
+                                     size_t* residentBytes,
+                                     size_t* referencedBytes);
+
+/**
+ * Loads an IR set, from the on-disk cache if an entry exists for this key, or
+ * otherwise from the SOFA file itself (in which case the IRs are converted to
+ * the host sample rate, and a new cache entry is also written)
+ *
+ * @param[out] phIRs    (&) address of the IR set; NULL on failure
+ * @param[in]  path     SOFA file path; NULL: the default HRIRs (not cached)
+ * @param[in]  cacheDir Cache directory; NULL or empty: caching is disabled
+ * @param[in]  cacheSizeLimit Size limit of the cache, in bytes; 0: none
+ * @param[in]  key      Hash of the SOFA file, and the load configuration
+ * @param[in]  progress Progress of the load; may be NULL
+ * @returns SAF_SOFA_OK if the IR set was loaded, otherwise the SOFA reader error
+ */
+SAF_SOFA_ERROR_CODES hades_ir_set_load(hades_ir_set** const phIRs,
+                                       char* path,
+                                       const char* cacheDir,
+                                       size_t cacheSizeLimit,
+                                       const hades_ir_cache_key* key,
+                                       hades_progress* const progress);
+
+/**
+ * Loads an IR set from a SOFA file (bypassing the cache)
+ *
+ * The IR data is taken over from the SOFA reader without copying it
+ */
+SAF_SOFA_ERROR_CODES hades_ir_set_loadSofa(hades_ir_set** const phIRs,
+                                           char* path);
+
+/** Creates an IR set holding copies of the given arrays */
+void hades_ir_set_create(hades_ir_set** const phIRs,
+                         int nDirs,
+                         int nCh,
+                         int IRlength,
+                         float IR_fs,
+                         const float* dirs_deg,
+                         const float* IRs);
+
+/**
+ * Converts an IR set to another sample rate, in place (the IR length changes
+ * accordingly)
+ *
+ * Uses a polyphase table of Kaiser-windowed sinc kernels, scaled such that the
+ * frequency responses of the IRs are preserved. The directions are split
+ * between the calling thread and a temporary worker pool.
+ *
+ * @note Only for IR sets that own their arrays (i.e. not memory-mapped ones)
+ *
+ * @param[in] irs      IR set
+ * @param[in] fs       New sample rate, in Hz (rounded to the nearest Hz)
+ * @param[in] progress Advanced once per direction; may be NULL
+ */
+void hades_ir_set_resample(hades_ir_set* const irs,
+                           float fs,
+                           hades_progress* const progress);
+
+/**
+ * Trims the leading and trailing near-silence from the IRs of an IR set, in
+ * place
+ *
+ * The same samples are trimmed from every IR, such that each end holds no
+ * more than -60 dB of the total energy of the set. So, only
+ * the common (bulk) delay of the IRs changes, and not the differences between
+ * them. A short margin is kept either side, and faded out at the end.
+ *
+ * @note Only for IR sets that own their arrays (i.e. not memory-mapped ones)
+ */
+void hades_ir_set_truncate(hades_ir_set* const irs);
+
+/**
+ * Decimates the direction grid of an IR set, in place
+ *
+ * 'targetNumDirs' directions are first chosen by farthest-point sampling (so
+ * that they cover the grid as evenly as possible). Dropped directions are then
+ * added back, worst first, until the steering-vector error between every
+ * dropped direction and its nearest kept one is within 'maxSteeringError_dB'.
+ * The error is the largest, over third-octave bands, of one minus the squared
+ * normalised inner product of their (multichannel) spectra within the band.
+ * The kept directions retain their original order.
+ *
+ * @note Only for IR sets that own their arrays (i.e. not memory-mapped ones)
+ *
+ * @param[in] irs                 IR set
+ * @param[in] targetNumDirs       Number of directions to keep (at least);
+ *                                nothing is done if 0, or all of them
+ * @param[in] maxSteeringError_dB Error bound, in dB; 0: unbounded
+ */
+void hades_ir_set_decimate(hades_ir_set* const irs,
+                           int targetNumDirs,
+                           float maxSteeringError_dB);
+
+/**
+ * Memory-maps a cache entry as an IR set
+ *
+ * @returns 1 if a valid entry was found, 0 if not (missing, stale, corrupt, or
+ *          written by a different version or host)
+ */
+int hades_ir_set_loadCache(hades_ir_set** const phIRs,
+                           const char* cacheDir,
+                           const hades_ir_cache_key* key);
+
+/**
+ * Writes an IR set to the cache (replacing any existing entry atomically), and
+ * then removes the least recently used entries, until the cache is within
+ * 'cacheSizeLimit' bytes (0: no limit)
+ *
+ * @returns 1 if successful, 0 otherwise
+ */
+int hades_ir_set_saveCache(const hades_ir_set* irs,
+                           const char* cacheDir,
+                           size_t cacheSizeLimit,
+                           const hades_ir_cache_key* key);
+
+/** Initial value for hades_hashBytes() */
+#define HADES_HASH_INIT ( 0xcbf29ce484222325ull )
+
+/**
+ * Folds 'size' bytes into a 64-bit hash, and returns the result
+ *
+ * The hash is FNV-1a-like (same offset basis and prime), but applied to 8-byte
+ * words, each followed by an xor-shift; it does not match FNV-1a.
+ *
+ * @note Hashing data in several calls gives the same result as in one call,
+ *       only if all but the last call are given multiples of 8 bytes
+ */
+uint64_t hades_hashBytes(uint64_t h,
+                         const void* data,
+                         size_t size);
+
+/**
+ * Computes a 64-bit hash of a file's contents (see hades_hashBytes()); returns
+ * 0 on failure
+ */
+int hades_ir_set_hashFile(const char* path,
+                          uint64_t* hash);
+
+/** Destroys an IR set (unmapping it, if it was loaded from the cache) */
+void hades_ir_set_destroy(hades_ir_set** const phIRs);
+
+/** Returns the memory occupied by an IR set, in bytes (0 if NULL) */
+size_t hades_ir_set_getSize(const hades_ir_set* irs);
+
+/**
+ * Maps a file into memory as private (copy-on-write) pages; returns NULL on
+ * failure (or if the file is empty)
+ */
+void* hades_file_map(const char* path,
+                     size_t* size);
+
+/**
+ * Returns the size and last modification time (in platform units) of a
+ * regular file; returns 0 if there is no such file
+ */
+int hades_file_getInfo(const char* path,
+                       uint64_t* size,
+                       int64_t* modTime);
+
+/** Unmaps a file mapped with hades_file_map() */
+void hades_file_unmap(void* mapping,
+                      size_t size);
+
+/** Returns the ID of the current process */
+unsigned long hades_getProcessId(void);
+
+/** Returns the number of processors currently online (at least 1) */
+int hades_getNumProcessors(void);
+
+/** Returns the time elapsed since an arbitrary (fixed) point, in ms */
+double hades_getWallTime_ms(void);
+
+/** Returns the CPU time spent by the calling thread so far, in ms */
+double hades_getThreadCpuTime_ms(void);
+
+/** Returns the peak resident memory of the process so far, in bytes */
+size_t hades_getPeakResidentBytes(void);
 
 
 #ifdef __cplusplus
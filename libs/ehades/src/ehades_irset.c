@@ -0,0 +1,1329 @@
+/*
+ * This file is part of HADES
+ * Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+ *
+ * HADES is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+ * License.
+ */
+
+/**
+ * @file ehades_irset.c
+ * @brief Loading of measured impulse response sets (microphone array IRs and
+ *        HRIRs) from SOFA files, with an optional on-disk cache, and a
+ *        process-wide registry through which they are shared
+ *
+ * The cache holds the ingested IR payload in a flat, versioned binary file,
+ * which is memory-mapped when read back, so that warm initialisations bypass
+ * the SOFA reader entirely. Entries are content-addressed: they are keyed by a
+ * hash of the SOFA file contents, along with the host sample rate and the
+ * load-time reduction (i.e. only what affects the stored IRs). The file hashes
+ * are remembered by path, size and modification time, so a file is only read
+ * in full again once it has changed. Once the entries exceed the size limit,
+ * the least recently used ones are removed. Only the IRs themselves are
+ * cached: the per-band tables derived from them are built inside the SAF
+ * analysis/synthesis objects, which are opaque, and offer no way of storing
+ * or restoring them.
+ *
+ * The registry uses the same keys, so that any number of hades_renderer
+ * instances loading the same SOFA file (for the same sample rate and
+ * reduction) share a single, reference-counted copy of its IR set.
+ *
+ * IRs measured at a sample rate other than the host's are converted upon
+ * loading (and cached in that form), so that one measurement set may be used
+ * for any host sample rate.
+ *
+ * @author Janani Fernandez & Leo McCormack
+ * @date 09.04.2021
+ * @license GNU GPLv2
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+# define _POSIX_C_SOURCE 200809L /* for mmap() etc. */
+#endif
+
+#include "ehades.h"
+#include "ehades_internal.h"
+#ifdef _WIN32
+# include <psapi.h>
+# include <sys/utime.h>
+#else
+# include <dirent.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# include <utime.h>
+#endif
+
+#define IR_CACHE_MAGIC "HADESIRC"
+#define IR_CACHE_VERSION ( 4 )         /* Increment whenever the file layout or its contents change */
+#define IR_CACHE_FILE_PREFIX "hades_irset_"
+#define IR_CACHE_FILE_SUFFIX ".bin"
+#define IR_CACHE_ENDIAN_CHECK ( 0x01020304u )
+#define IR_CACHE_ALIGNMENT ( 64 )      /* Byte alignment of the payload arrays within the file */
+#define IR_RESAMPLE_ZERO_CROSSINGS ( 32 ) /* Interpolation kernel half-length, in zero crossings of its cut-off */
+#define IR_RESAMPLE_ROLLOFF ( 0.94 )      /* Cut-off, relative to the lower of the two Nyquist frequencies */
+#define IR_RESAMPLE_KAISER_BETA ( 9.0 )   /* Kaiser window shape (roughly 90 dB of stop-band attenuation) */
+#define IR_RESAMPLE_MAX_PHASES ( 4096 )   /* Kernel table limit, for rate ratios that do not reduce to small integers */
+#define IR_SOURCE_DEFAULT_HRIRS ( 0 )     /* hades_ir_cache_key::sourceHash of the default HRIRs (which have no file) */
+#define IR_TRUNCATE_THRESHOLD_DB ( -60.0 ) /* Energy that may be trimmed from either end of the IRs, relative to the total */
+#define IR_TRUNCATE_MARGIN_MS ( 0.5 )     /* Kept either side of the trimmed IRs (and faded out, at the end) */
+#define IR_TRUNCATE_MIN_LENGTH ( 128 )    /* IRs are never trimmed to fewer samples than this */
+#define IR_STEERING_BANDS_PER_OCTAVE ( 3 ) /* Resolution of the steering-vector error of a decimation */
+#define IR_STEERING_MIN_FREQ ( 100.0 )    /* Bins below this are grouped into the lowest band, in Hz */
+#define IR_STEERING_BAND_FLOOR_DB ( -60.0 ) /* Bands this far below the strongest band of a direction are left out of its error */
+
+/** Cache file header (followed by the direction and IR arrays) */
+typedef struct _hades_ir_cache_header {
+    char magic[8];                     /**< IR_CACHE_MAGIC */
+    uint32_t version;                  /**< IR_CACHE_VERSION */
+    uint32_t endianCheck;              /**< IR_CACHE_ENDIAN_CHECK, as written by the host */
+    hades_ir_cache_key key;            /**< What this entry was built from/for */
+    int32_t nDirs;                     /**< Number of directions */
+    int32_t nCh;                       /**< Number of channels per direction */
+    int32_t IRlength;                  /**< IR length, in samples */
+    float IR_fs;                       /**< IR sample rate, in Hz */
+    float sourceFs;                    /**< Sample rate of the SOFA file, in Hz */
+    int32_t reserved;                  /**< Unused (zero) */
+    uint64_t dirsOffset;               /**< Offset of the directions (nDirs x 2), in bytes */
+    uint64_t IRsOffset;                /**< Offset of the IRs (nDirs x nCh x IRlength), in bytes */
+    uint64_t fileSize;                 /**< Size of the entry (i.e. the whole file), in bytes */
+} hades_ir_cache_header;
+
+static size_t hades_ir_cache_align(size_t offset)
+{
+    return (offset + IR_CACHE_ALIGNMENT - 1) / IR_CACHE_ALIGNMENT * IR_CACHE_ALIGNMENT;
+}
+
+static void hades_ir_cache_getPath(const char* cacheDir, const hades_ir_cache_key* key, char* path, size_t pathSize)
+{
+    snprintf(path, pathSize, "%s/" IR_CACHE_FILE_PREFIX "%016llx_%d_%d_%d_%d" IR_CACHE_FILE_SUFFIX, cacheDir,
+             (unsigned long long)key->sourceHash, (int)(key->fs+0.5f), (int)key->reduction.truncate,
+             (int)key->reduction.targetNumDirs, (int)floorf(-10.0f*key->reduction.maxSteeringError_dB+0.5f));
+}
+
+/** Cache entry file, as listed by hades_ir_cache_evict() */
+typedef struct _hades_ir_cache_file {
+    char name[128];                    /**< File name (within the cache directory) */
+    uint64_t size;                     /**< File size, in bytes */
+    int64_t modTime;                   /**< Last modification (i.e. last use, see hades_ir_set_loadCache()) */
+} hades_ir_cache_file;
+
+static int hades_ir_cache_isEntryName(const char* name)
+{
+    size_t len = strlen(name), prefixLen = strlen(IR_CACHE_FILE_PREFIX), suffixLen = strlen(IR_CACHE_FILE_SUFFIX);
+    return len > prefixLen+suffixLen && len < sizeof(((hades_ir_cache_file*)0)->name) &&
+           strncmp(name, IR_CACHE_FILE_PREFIX, prefixLen)==0 && strcmp(&name[len-suffixLen], IR_CACHE_FILE_SUFFIX)==0;
+}
+
+static int hades_ir_cache_compareAge(const void* a, const void* b)
+{
+    int64_t ta = ((const hades_ir_cache_file*)a)->modTime, tb = ((const hades_ir_cache_file*)b)->modTime;
+    return ta<tb ? -1 : (ta>tb ? 1 : 0);
+}
+
+/* Removes the least recently used entries from the cache directory, until the remaining ones take no more than
+ * 'sizeLimit' bytes (0: no limit); the entry named 'keepName' is never removed. Entries that are still mapped by
+ * another process may fail to be removed (on Windows), and are skipped */
+static void hades_ir_cache_evict(const char* cacheDir, size_t sizeLimit, const char* keepName)
+{
+    hades_ir_cache_file* files;
+    char path[4096];
+    int i, nFiles, maxFiles;
+    uint64_t totalSize;
+#ifdef _WIN32
+    WIN32_FIND_DATAA findData;
+    HANDLE find;
+#else
+    DIR* dir;
+    struct dirent* dirEntry;
+#endif
+
+    if(sizeLimit==0)
+        return;
+
+    /* List the entries (the temporary files of entries being written are left out) */
+    nFiles = maxFiles = 0;
+    files = NULL;
+    totalSize = 0;
+#ifdef _WIN32
+    snprintf(path, sizeof(path), "%s/" IR_CACHE_FILE_PREFIX "*", cacheDir);
+    if((find = FindFirstFileA(path, &findData))==INVALID_HANDLE_VALUE)
+        return;
+    do{
+        if((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || !hades_ir_cache_isEntryName(findData.cFileName))
+            continue;
+        if(nFiles==maxFiles)
+            files = (hades_ir_cache_file*)realloc1d(files, (maxFiles = 2*maxFiles+16)*sizeof(hades_ir_cache_file));
+        strcpy(files[nFiles].name, findData.cFileName);
+        files[nFiles].size = ((uint64_t)findData.nFileSizeHigh<<32) | findData.nFileSizeLow;
+        files[nFiles].modTime = (int64_t)(((uint64_t)findData.ftLastWriteTime.dwHighDateTime<<32) |
+                                          findData.ftLastWriteTime.dwLowDateTime);
+        totalSize += files[nFiles++].size;
+    } while(FindNextFileA(find, &findData));
+    FindClose(find);
+#else
+    if((dir = opendir(cacheDir))==NULL)
+        return;
+    while((dirEntry = readdir(dir))!=NULL){
+        if(!hades_ir_cache_isEntryName(dirEntry->d_name))
+            continue;
+        if(nFiles==maxFiles)
+            files = (hades_ir_cache_file*)realloc1d(files, (maxFiles = 2*maxFiles+16)*sizeof(hades_ir_cache_file));
+        snprintf(path, sizeof(path), "%s/%s", cacheDir, dirEntry->d_name);
+        if(!hades_file_getInfo(path, &files[nFiles].size, &files[nFiles].modTime))
+            continue; /* (removed in the meantime) */
+        strcpy(files[nFiles].name, dirEntry->d_name);
+        totalSize += files[nFiles++].size;
+    }
+    closedir(dir);
+#endif
+
+    /* Oldest first */
+    if(totalSize > (uint64_t)sizeLimit){
+        qsort(files, nFiles, sizeof(hades_ir_cache_file), hades_ir_cache_compareAge);
+        for(i=0; i<nFiles && totalSize > (uint64_t)sizeLimit; i++){
+            if(keepName!=NULL && strcmp(files[i].name, keepName)==0)
+                continue;
+            snprintf(path, sizeof(path), "%s/%s", cacheDir, files[i].name);
+            if(remove(path)==0)
+                totalSize -= files[i].size;
+        }
+    }
+    free(files);
+}
+
+uint64_t hades_hashBytes(uint64_t h, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t i;
+    uint64_t word;
+
+    /* FNV-1a-style, but folding in 8 bytes at a time (bytewise is too slow for large files), with an extra
+     * xor-shift per word so that the high bits reach the low ones. Hence, it is not FNV-1a compatible */
+    for(i=0; i+8<=size; i+=8){
+        memcpy(&word, &bytes[i], 8);
+        h ^= word;
+        h *= 0x100000001b3ull;
+        h ^= h >> 32;
+    }
+    for(; i<size; i++){
+        h ^= bytes[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+int hades_ir_set_hashFile(const char* path, uint64_t* hash)
+{
+    FILE* file;
+    unsigned char* block;
+    size_t nRead;
+    uint64_t h;
+
+    if(path==NULL || (file = fopen(path, "rb"))==NULL)
+        return 0;
+    block = malloc1d(1<<20);
+    h = HADES_HASH_INIT;
+    while((nRead = fread(block, 1, 1<<20, file)) > 0)
+        h = hades_hashBytes(h, block, nRead); /* (blocks are a multiple of 8 bytes, bar the last) */
+    free(block);
+    fclose(file);
+    (*hash) = h;
+    return 1;
+}
+
+SAF_SOFA_ERROR_CODES hades_ir_set_loadSofa(hades_ir_set** const phIRs, char* path)
+{
+    hades_ir_set* irs;
+    saf_sofa_container sofa;
+    SAF_SOFA_ERROR_CODES error;
+
+    (*phIRs) = NULL;
+    error = saf_sofa_open(&sofa, path, SAF_SOFA_READER_OPTION_DEFAULT);
+    if(error==SAF_SOFA_OK){
+        irs = (hades_ir_set*)malloc1d(sizeof(hades_ir_set));
+        irs->nDirs = sofa.nSources;
+        irs->nCh = sofa.nReceivers;
+        irs->IRlength = sofa.DataLengthIR;
+        irs->IR_fs = irs->sourceFs = sofa.DataSamplingRate;
+        irs->dirs_deg = malloc1d(irs->nDirs*2*sizeof(float));
+        cblas_scopy(irs->nDirs, sofa.SourcePosition, 3, irs->dirs_deg, 2); /* azi */
+        cblas_scopy(irs->nDirs, &sofa.SourcePosition[1], 3, &irs->dirs_deg[1], 2); /* elev */
+
+        /* The IR data is already in the required layout, so ownership is taken from the container, rather than
+         * copying it (saf_sofa_close() skips NULL pointers) */
+        irs->IRs = sofa.DataIR;
+        sofa.DataIR = NULL;
+        irs->mapping = NULL;
+        irs->mappingSize = 0;
+        (*phIRs) = irs;
+    }
+    saf_sofa_close(&sofa);
+    return error;
+}
+
+void hades_ir_set_create
+(
+    hades_ir_set** const phIRs,
+    int nDirs,
+    int nCh,
+    int IRlength,
+    float IR_fs,
+    const float* dirs_deg,
+    const float* IRs
+)
+{
+    hades_ir_set* irs = (hades_ir_set*)malloc1d(sizeof(hades_ir_set));
+    irs->nDirs = nDirs;
+    irs->nCh = nCh;
+    irs->IRlength = IRlength;
+    irs->IR_fs = irs->sourceFs = IR_fs;
+    irs->dirs_deg = malloc1d(nDirs*2*sizeof(float));
+    memcpy(irs->dirs_deg, dirs_deg, nDirs*2*sizeof(float));
+    irs->IRs = malloc1d((size_t)nDirs*nCh*IRlength*sizeof(float));
+    memcpy(irs->IRs, IRs, (size_t)nDirs*nCh*IRlength*sizeof(float));
+    irs->mapping = NULL;
+    irs->mappingSize = 0;
+    (*phIRs) = irs;
+}
+
+/** Polyphase table of interpolation kernels, for one sample rate ratio */
+typedef struct _hades_ir_resampler {
+    int L;                             /**< Output rate, divided by the GCD of the two rates */
+    int M;                             /**< Input rate, divided by the GCD of the two rates */
+    int nPhases;                       /**< Number of kernel phases (L, unless it exceeds IR_RESAMPLE_MAX_PHASES) */
+    int nTaps;                         /**< Taps per kernel (even; centred between the middle two) */
+    float* kernels;                    /**< Kernels; FLAT: (nPhases+1) x nTaps */
+} hades_ir_resampler;
+
+/** Resampling job: converts the IRs of directions [dir0, dir1) */
+typedef struct _hades_ir_resample_job {
+    const hades_ir_resampler* rs;      /**< Kernel table */
+    const float* in;                   /**< Input IRs; FLAT: nDirs x nCh x lenIn */
+    float* out;                        /**< Output IRs; FLAT: nDirs x nCh x lenOut */
+    int nCh, lenIn, lenOut;            /**< Number of channels, and the input/output IR lengths */
+    int dir0, dir1;                    /**< Range of directions */
+    hades_progress* progress;          /**< Advanced once per direction; may be NULL */
+} hades_ir_resample_job;
+
+/* Zeroth-order modified Bessel function of the first kind (for the Kaiser window) */
+static double hades_besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    int k;
+
+    for(k=1; k<64 && term>1e-12*sum; k++){
+        term *= (x*x)/(4.0*k*k);
+        sum += term;
+    }
+    return sum;
+}
+
+static long hades_gcd(long a, long b)
+{
+    long t;
+
+    while(b!=0){
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static void hades_ir_resampler_create(hades_ir_resampler* rs, long fsIn, long fsOut)
+{
+    double cutoff, gain, tau, x;
+    int ph, j, halfTaps;
+    long g;
+
+    g = hades_gcd(fsIn, fsOut);
+    rs->L = (int)(fsOut/g);
+    rs->M = (int)(fsIn/g);
+    rs->nPhases = SAF_MIN(rs->L, IR_RESAMPLE_MAX_PHASES);
+
+    /* Windowed-sinc low-pass, below the lower of the two Nyquist frequencies (in cycles per input sample x2). The
+     * kernels are scaled by fsIn/fsOut, so that the frequency responses of the IRs (rather than their sample values)
+     * are preserved */
+    cutoff = IR_RESAMPLE_ROLLOFF * SAF_MIN(1.0, (double)rs->L/(double)rs->M);
+    gain = cutoff * (double)rs->M/(double)rs->L;
+    halfTaps = (int)ceil((double)IR_RESAMPLE_ZERO_CROSSINGS/cutoff);
+    rs->nTaps = 2*halfTaps;
+    rs->kernels = malloc1d((size_t)(rs->nPhases+1)*rs->nTaps*sizeof(float));
+    for(ph=0; ph<=rs->nPhases; ph++){
+        for(j=0; j<rs->nTaps; j++){
+            /* Distance from the interpolation point to tap j, in input samples */
+            tau = (double)ph/(double)rs->nPhases + (double)(halfTaps-1-j);
+            x = tau/(double)halfTaps;
+            rs->kernels[(size_t)ph*rs->nTaps+j] = fabs(x)>=1.0 ? 0.0f :
+                (float)(gain * (tau==0.0 ? 1.0 : sin(SAF_PId*cutoff*tau)/(SAF_PId*cutoff*tau)) *
+                        hades_besselI0(IR_RESAMPLE_KAISER_BETA*sqrt(1.0-x*x))/hades_besselI0(IR_RESAMPLE_KAISER_BETA));
+        }
+    }
+}
+
+static void hades_ir_resample_run(void* arg)
+{
+    hades_ir_resample_job* job = (hades_ir_resample_job*)arg;
+    const hades_ir_resampler* rs = job->rs;
+    const float* x, *h;
+    float* y;
+    float acc;
+    long long pos;
+    int row, n, j, j0, j1, k, ph, rem;
+
+    for(row=job->dir0*job->nCh; row<job->dir1*job->nCh; row++){
+        x = &job->in[(size_t)row*job->lenIn];
+        y = &job->out[(size_t)row*job->lenOut];
+        for(n=0; n<job->lenOut; n++){
+            /* Output sample n lies at input time n*M/L, i.e. 'rem' L-ths of a sample after input sample 'pos' */
+            pos = (long long)n*rs->M;
+            rem = (int)(pos % rs->L);
+            pos /= rs->L;
+            ph = rs->nPhases==rs->L ? rem : (int)(((long long)rem*rs->nPhases + rs->L/2)/rs->L);
+            h = &rs->kernels[(size_t)ph*rs->nTaps];
+            k = (int)pos - rs->nTaps/2 + 1;
+            j0 = SAF_MAX(0, -k);
+            j1 = SAF_MIN(rs->nTaps, job->lenIn - k);
+            acc = 0.0f;
+            for(j=j0; j<j1; j++)
+                acc += h[j] * x[k+j];
+            y[n] = acc;
+        }
+        if((row+1)%job->nCh==0)
+            hades_progress_advance(job->progress, 1);
+    }
+}
+
+void hades_ir_set_resample(hades_ir_set* const irs, float fs, hades_progress* const progress)
+{
+    hades_ir_resampler rs;
+    hades_ir_resample_job jobs[MAX_NUM_POOL_JOBS];
+    hades_job_fn fns[MAX_NUM_POOL_JOBS];
+    void* args[MAX_NUM_POOL_JOBS];
+    hades_worker_pool* hPool;
+    float* IRs;
+    int i, nJobs, lenOut;
+
+    saf_assert(irs->mapping==NULL, "Memory-mapped IR sets are read-only");
+    if(irs->IR_fs<=0.0f || fs<=0.0f || (long)(irs->IR_fs+0.5f)==(long)(fs+0.5f))
+        return;
+    hades_ir_resampler_create(&rs, (long)(irs->IR_fs+0.5f), (long)(fs+0.5f));
+    lenOut = (int)(((long long)irs->IRlength*rs.L + rs.M - 1)/rs.M);
+    IRs = malloc1d((size_t)irs->nDirs*irs->nCh*lenOut*sizeof(float));
+    hades_progress_begin(progress, irs->nDirs);
+
+    /* The directions are split between this thread and a temporary worker pool */
+    nJobs = SAF_MAX(1, SAF_MIN(SAF_MIN(MAX_NUM_POOL_JOBS, hades_getNumProcessors()), irs->nDirs));
+    for(i=0; i<nJobs; i++){
+        jobs[i].rs = &rs;
+        jobs[i].in = irs->IRs;
+        jobs[i].out = IRs;
+        jobs[i].nCh = irs->nCh;
+        jobs[i].lenIn = irs->IRlength;
+        jobs[i].lenOut = lenOut;
+        jobs[i].dir0 = (int)((long long)irs->nDirs*i/nJobs);
+        jobs[i].dir1 = (int)((long long)irs->nDirs*(i+1)/nJobs);
+        jobs[i].progress = progress;
+        fns[i] = hades_ir_resample_run;
+        args[i] = &jobs[i];
+    }
+    if(nJobs>1){
+        hades_worker_pool_create(&hPool, nJobs-1);
+        hades_worker_pool_post(hPool, fns, args, nJobs);
+        hades_worker_pool_join(hPool);
+        hades_worker_pool_destroy(&hPool);
+    }
+    else
+        hades_ir_resample_run(&jobs[0]);
+    free(rs.kernels);
+
+    free(irs->IRs);
+    irs->IRs = IRs;
+    irs->IRlength = lenOut;
+    irs->IR_fs = fs;
+}
+
+void hades_ir_set_truncate(hades_ir_set* const irs)
+{
+    double* energy;
+    double total, threshold, sum;
+    float* IRs;
+    float* row;
+    int i, n, nRows, start, end, margin, length;
+
+    saf_assert(irs->mapping==NULL, "Memory-mapped IR sets are read-only");
+    if(irs->IRlength<=IR_TRUNCATE_MIN_LENGTH)
+        return;
+
+    /* Energy of all IRs, per sample */
+    nRows = irs->nDirs*irs->nCh;
+    energy = (double*)calloc1d(irs->IRlength, sizeof(double));
+    for(i=0; i<nRows; i++){
+        row = &irs->IRs[(size_t)i*irs->IRlength];
+        for(n=0; n<irs->IRlength; n++)
+            energy[n] += (double)row[n]*(double)row[n];
+    }
+    for(n=0, total=0.0; n<irs->IRlength; n++)
+        total += energy[n];
+    threshold = total*pow(10.0, IR_TRUNCATE_THRESHOLD_DB/10.0);
+
+    /* The ends that hold no more than the threshold between them, plus the margin */
+    for(start=0, sum=0.0; start<irs->IRlength && sum+energy[start]<=threshold; start++)
+        sum += energy[start];
+    for(end=irs->IRlength, sum=0.0; end>start && sum+energy[end-1]<=threshold; end--)
+        sum += energy[end-1];
+    free(energy);
+    margin = (int)(IR_TRUNCATE_MARGIN_MS*irs->IR_fs/1000.0 + 0.5);
+    start = SAF_MAX(start-margin, 0);
+    end = SAF_MIN(end+margin, irs->IRlength);
+    if(end-start<IR_TRUNCATE_MIN_LENGTH){
+        end = SAF_MIN(start+IR_TRUNCATE_MIN_LENGTH, irs->IRlength);
+        start = end-IR_TRUNCATE_MIN_LENGTH;
+    }
+    length = end-start;
+    if(length>=irs->IRlength)
+        return;
+
+    /* Copy the kept part, fading out the margin at the end (if it was trimmed) */
+    IRs = (float*)malloc1d((size_t)nRows*length*sizeof(float));
+    for(i=0; i<nRows; i++){
+        row = &IRs[(size_t)i*length];
+        memcpy(row, &irs->IRs[(size_t)i*irs->IRlength+start], length*sizeof(float));
+        if(end<irs->IRlength){
+            for(n=0; n<SAF_MIN(margin, length); n++)
+                row[length-1-n] *= 0.5f - 0.5f*cosf(SAF_PI*(float)n/(float)SAF_MAX(margin, 1));
+        }
+    }
+    free(irs->IRs);
+    irs->IRs = IRs;
+    irs->IRlength = length;
+}
+
+/** Per-band steering vectors of an IR set (the spectra of its IRs), for bounding the error of a decimation */
+typedef struct _hades_ir_steering {
+    int nCh;                           /**< Number of channels per direction */
+    int nBins;                         /**< Number of bins per IR (DC is left out) */
+    int nBands;                        /**< Number of bands */
+    int* bandStart;                    /**< First bin of each band; (nBands+1) x 1, the last being nBins */
+    float_complex* spectra;            /**< Spectra of the IRs; FLAT: nDirs x nCh x nBins */
+    double* bandEnergy;                /**< Energy of each direction per band; FLAT: nDirs x nBands */
+    double* energyFloor;               /**< Bands of a direction with no more energy than this are skipped; nDirs x 1 */
+} hades_ir_steering;
+
+static void hades_ir_steering_create(hades_ir_steering* st, const hades_ir_set* irs)
+{
+    void* hFFT;
+    float* frameTD;
+    float_complex* frameFD;
+    float_complex X;
+    double binHz, maxEnergy, f;
+    int d, ch, k, b, band, prevBand, N;
+
+    /* The FFT spans the whole IR */
+    for(N=2; N<irs->IRlength; N*=2);
+    st->nCh = irs->nCh;
+    st->nBins = N/2;
+    binHz = (double)irs->IR_fs/(double)N;
+
+    /* Fractional-octave bands, skipping those with no bins */
+    st->bandStart = (int*)malloc1d((st->nBins+1)*sizeof(int));
+    st->nBands = 0;
+    for(k=1, prevBand=-1; k<=st->nBins; k++){
+        f = (double)k*binHz;
+        band = f<IR_STEERING_MIN_FREQ ? 0 : 1 + (int)floor(IR_STEERING_BANDS_PER_OCTAVE*log2(f/IR_STEERING_MIN_FREQ));
+        if(band!=prevBand)
+            st->bandStart[st->nBands++] = k-1;
+        prevBand = band;
+    }
+    st->bandStart[st->nBands] = st->nBins;
+
+    /* Spectra, and the energy per band */
+    st->spectra = (float_complex*)malloc1d((size_t)irs->nDirs*st->nCh*st->nBins*sizeof(float_complex));
+    st->bandEnergy = (double*)calloc1d((size_t)irs->nDirs*st->nBands, sizeof(double));
+    st->energyFloor = (double*)malloc1d(irs->nDirs*sizeof(double));
+    frameTD = (float*)calloc1d(N, sizeof(float));
+    frameFD = (float_complex*)malloc1d((N/2+1)*sizeof(float_complex));
+    saf_rfft_create(&hFFT, N);
+    for(d=0; d<irs->nDirs; d++){
+        for(ch=0; ch<st->nCh; ch++){
+            memcpy(frameTD, &irs->IRs[((size_t)d*st->nCh+ch)*irs->IRlength], irs->IRlength*sizeof(float));
+            saf_rfft_forward(hFFT, frameTD, frameFD);
+            memcpy(&st->spectra[((size_t)d*st->nCh+ch)*st->nBins], &frameFD[1], st->nBins*sizeof(float_complex));
+            for(b=0; b<st->nBands; b++){
+                for(k=st->bandStart[b]; k<st->bandStart[b+1]; k++){
+                    X = frameFD[k+1];
+                    st->bandEnergy[(size_t)d*st->nBands+b] += (double)crealf(X)*crealf(X) + (double)cimagf(X)*cimagf(X);
+                }
+            }
+        }
+        for(b=0, maxEnergy=0.0; b<st->nBands; b++)
+            maxEnergy = SAF_MAX(maxEnergy, st->bandEnergy[(size_t)d*st->nBands+b]);
+        st->energyFloor[d] = maxEnergy*pow(10.0, IR_STEERING_BAND_FLOOR_DB/10.0);
+    }
+    saf_rfft_destroy(&hFFT);
+    free(frameTD);
+    free(frameFD);
+}
+
+static void hades_ir_steering_destroy(hades_ir_steering* st)
+{
+    free(st->bandStart);
+    free(st->spectra);
+    free(st->bandEnergy);
+    free(st->energyFloor);
+}
+
+/* Steering-vector error between two directions of an IR set; the largest over the bands of 1-|<a,b>|^2/(|a|^2 |b|^2),
+ * where a and b are the spectra of all channels within the band; [0..1] */
+static double hades_ir_set_getSteeringError(const hades_ir_steering* st, int dirA, int dirB)
+{
+    const float_complex* a;
+    const float_complex* b;
+    double re, im, energyA, energyB, error;
+    int ch, k, band;
+
+    error = 0.0;
+    for(band=0; band<st->nBands; band++){
+        energyA = st->bandEnergy[(size_t)dirA*st->nBands+band];
+        energyB = st->bandEnergy[(size_t)dirB*st->nBands+band];
+        if(energyA<=st->energyFloor[dirA] || energyB<=st->energyFloor[dirB])
+            continue; /* (too weak for its direction to matter) */
+        re = im = 0.0;
+        for(ch=0; ch<st->nCh; ch++){
+            a = &st->spectra[((size_t)dirA*st->nCh+ch)*st->nBins];
+            b = &st->spectra[((size_t)dirB*st->nCh+ch)*st->nBins];
+            for(k=st->bandStart[band]; k<st->bandStart[band+1]; k++){ /* conj(a)*b */
+                re += (double)crealf(a[k])*crealf(b[k]) + (double)cimagf(a[k])*cimagf(b[k]);
+                im += (double)crealf(a[k])*cimagf(b[k]) - (double)cimagf(a[k])*crealf(b[k]);
+            }
+        }
+        error = SAF_MAX(error, 1.0 - (re*re + im*im)/(energyA*energyB));
+    }
+    return SAF_MAX(error, 0.0);
+}
+
+void hades_ir_set_decimate(hades_ir_set* const irs, int targetNumDirs, float maxSteeringError_dB)
+{
+    float* xyz;
+    float* maxCos;
+    float* dirs_deg;
+    float* IRs;
+    double* error;
+    double bound;
+    hades_ir_steering steering;
+    int* nearest;
+    int* kept;
+    int i, d, len, nKept, next;
+    float c;
+
+    saf_assert(irs->mapping==NULL, "Memory-mapped IR sets are read-only");
+    if(targetNumDirs<=0 || targetNumDirs>=irs->nDirs)
+        return;
+    len = irs->nCh*irs->IRlength;
+    xyz = (float*)malloc1d(irs->nDirs*3*sizeof(float));
+    maxCos = (float*)malloc1d(irs->nDirs*sizeof(float));
+    error = (double*)malloc1d(irs->nDirs*sizeof(double));
+    nearest = (int*)malloc1d(irs->nDirs*sizeof(int));
+    kept = (int*)calloc1d(irs->nDirs, sizeof(int));
+    unitSph2cart(irs->dirs_deg, irs->nDirs, SAF_TRUE, xyz);
+    for(d=0; d<irs->nDirs; d++){
+        maxCos[d] = -2.0f;
+        nearest[d] = -1;
+    }
+
+    /* Farthest-point sampling: each direction added is the one furthest from its nearest kept direction so far */
+    nKept = 0;
+    next = 0;
+    for(;;){
+        kept[next] = 1;
+        nKept++;
+        for(d=0; d<irs->nDirs; d++){
+            c = xyz[d*3]*xyz[next*3] + xyz[d*3+1]*xyz[next*3+1] + xyz[d*3+2]*xyz[next*3+2];
+            if(!kept[d] && c>maxCos[d]){
+                maxCos[d] = c;
+                nearest[d] = next;
+            }
+        }
+        if(nKept>=targetNumDirs)
+            break;
+        for(d=0, next=-1; d<irs->nDirs; d++){
+            if(!kept[d] && (next<0 || maxCos[d]<maxCos[next]))
+                next = d;
+        }
+    }
+
+    /* Then, the dropped directions with the largest steering-vector errors are added back, until all are within the bound */
+    bound = pow(10.0, (double)SAF_MIN(maxSteeringError_dB, 0.0f)/10.0);
+    hades_ir_steering_create(&steering, irs);
+    for(d=0; d<irs->nDirs; d++)
+        error[d] = kept[d] ? 0.0 : hades_ir_set_getSteeringError(&steering, d, nearest[d]);
+    for(;;){
+        for(d=0, next=-1; d<irs->nDirs; d++){
+            if(!kept[d] && (next<0 || error[d]>error[next]))
+                next = d;
+        }
+        if(next<0 || error[next]<=bound)
+            break;
+        kept[next] = 1;
+        nKept++;
+        for(d=0; d<irs->nDirs; d++){
+            c = xyz[d*3]*xyz[next*3] + xyz[d*3+1]*xyz[next*3+1] + xyz[d*3+2]*xyz[next*3+2];
+            if(!kept[d] && c>maxCos[d]){
+                maxCos[d] = c;
+                nearest[d] = next;
+                error[d] = hades_ir_set_getSteeringError(&steering, d, next);
+            }
+        }
+    }
+    hades_ir_steering_destroy(&steering);
+
+    /* Keep those directions (in their original order) */
+    dirs_deg = (float*)malloc1d(nKept*2*sizeof(float));
+    IRs = (float*)malloc1d((size_t)nKept*len*sizeof(float));
+    for(d=0, i=0; d<irs->nDirs; d++){
+        if(!kept[d])
+            continue;
+        dirs_deg[i*2] = irs->dirs_deg[d*2];
+        dirs_deg[i*2+1] = irs->dirs_deg[d*2+1];
+        memcpy(&IRs[(size_t)i*len], &irs->IRs[(size_t)d*len], len*sizeof(float));
+        i++;
+    }
+    free(irs->dirs_deg);
+    free(irs->IRs);
+    irs->dirs_deg = dirs_deg;
+    irs->IRs = IRs;
+    irs->nDirs = nKept;
+    free(xyz);
+    free(maxCos);
+    free(error);
+    free(nearest);
+    free(kept);
+}
+
+/* Creates an IR set pointing into a cache entry at 'offset' within a memory-mapped file, taking ownership of the mapping
+ * if successful; returns 0 if the entry is not valid (stale, corrupt, or written by a different version or host) */
+static int hades_ir_set_mapCacheEntry(hades_ir_set** const phIRs, void* mapping, size_t mappingSize, size_t offset,
+                                      const hades_ir_cache_key* key)
+{
+    hades_ir_set* irs;
+    hades_ir_cache_header header;
+    char* entry;
+
+    /* Validate, as the file may be from an older version, another host, or have been truncated */
+    (*phIRs) = NULL;
+    if(offset % IR_CACHE_ALIGNMENT!=0 || offset+sizeof(header) > mappingSize)
+        return 0;
+    entry = (char*)mapping + offset;
+    memcpy(&header, entry, sizeof(header));
+    if(memcmp(header.magic, IR_CACHE_MAGIC, 8)!=0 || header.version!=IR_CACHE_VERSION ||
+       header.endianCheck!=IR_CACHE_ENDIAN_CHECK || memcmp(&header.key, key, sizeof(hades_ir_cache_key))!=0 ||
+       header.fileSize > (uint64_t)(mappingSize-offset) || header.nDirs<=0 || header.nCh<=0 || header.IRlength<=0 ||
+       header.dirsOffset+(uint64_t)header.nDirs*2*sizeof(float) > header.fileSize ||
+       header.IRsOffset+(uint64_t)header.nDirs*header.nCh*header.IRlength*sizeof(float) > header.fileSize)
+        return 0;
+
+    /* The arrays are used in place */
+    irs = (hades_ir_set*)malloc1d(sizeof(hades_ir_set));
+    irs->nDirs = header.nDirs;
+    irs->nCh = header.nCh;
+    irs->IRlength = header.IRlength;
+    irs->IR_fs = header.IR_fs;
+    irs->sourceFs = header.sourceFs;
+    irs->dirs_deg = (float*)(entry + header.dirsOffset);
+    irs->IRs = (float*)(entry + header.IRsOffset);
+    irs->mapping = mapping;
+    irs->mappingSize = mappingSize;
+    (*phIRs) = irs;
+    return 1;
+}
+
+int hades_ir_set_loadCache(hades_ir_set** const phIRs, const char* cacheDir, const hades_ir_cache_key* key)
+{
+    char path[4096];
+    void* mapping;
+    size_t mappingSize;
+
+    (*phIRs) = NULL;
+    if(cacheDir==NULL || cacheDir[0]=='\0')
+        return 0;
+    hades_ir_cache_getPath(cacheDir, key, path, sizeof(path));
+    mapping = hades_file_map(path, &mappingSize);
+    if(mapping==NULL)
+        return 0;
+    if(!hades_ir_set_mapCacheEntry(phIRs, mapping, mappingSize, 0, key)){
+        hades_file_unmap(mapping, mappingSize);
+        return 0;
+    }
+
+    /* The modification time is updated on every use, so that hades_ir_cache_evict() removes the least recently used */
+#ifdef _WIN32
+    _utime(path, NULL);
+#else
+    utime(path, NULL);
+#endif
+    return 1;
+}
+
+/* Writes an IR set as a cache entry at the current position of 'file' (padded, such that the arrays are aligned when
+ * the file is mapped); 'offset' (if not NULL) receives the position of the entry */
+static int hades_ir_set_writeCacheEntry(FILE* file, const hades_ir_set* irs, const hades_ir_cache_key* key,
+                                        uint64_t* offset)
+{
+    hades_ir_cache_header header;
+    size_t dirsSize, IRsSize, pos;
+    long start;
+    int ok;
+    static const char zeros[IR_CACHE_ALIGNMENT] = { 0 };
+
+    /* Padding, up to the next aligned position in the file */
+    if((start = ftell(file))<0)
+        return 0;
+    pos = hades_ir_cache_align((size_t)start);
+    if(fwrite(zeros, 1, pos-(size_t)start, file)!=pos-(size_t)start)
+        return 0;
+    if(offset!=NULL)
+        (*offset) = (uint64_t)pos;
+
+    /* Header (the offsets are relative to the start of the entry) */
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IR_CACHE_MAGIC, 8);
+    header.version = IR_CACHE_VERSION;
+    header.endianCheck = IR_CACHE_ENDIAN_CHECK;
+    header.key = *key;
+    header.nDirs = irs->nDirs;
+    header.nCh = irs->nCh;
+    header.IRlength = irs->IRlength;
+    header.IR_fs = irs->IR_fs;
+    header.sourceFs = irs->sourceFs;
+    dirsSize = (size_t)irs->nDirs*2*sizeof(float);
+    IRsSize = (size_t)irs->nDirs*irs->nCh*irs->IRlength*sizeof(float);
+    header.dirsOffset = hades_ir_cache_align(sizeof(header));
+    header.IRsOffset = hades_ir_cache_align(header.dirsOffset + dirsSize);
+    header.fileSize = header.IRsOffset + IRsSize;
+
+    ok = fwrite(&header, sizeof(header), 1, file)==1;
+    pos = sizeof(header);
+    ok = ok && fwrite(zeros, 1, header.dirsOffset-pos, file)==header.dirsOffset-pos;
+    ok = ok && fwrite(irs->dirs_deg, 1, dirsSize, file)==dirsSize;
+    pos = header.dirsOffset + dirsSize;
+    ok = ok && fwrite(zeros, 1, header.IRsOffset-pos, file)==header.IRsOffset-pos;
+    ok = ok && fwrite(irs->IRs, 1, IRsSize, file)==IRsSize;
+    return ok;
+}
+
+int hades_ir_set_saveCache(const hades_ir_set* irs, const char* cacheDir, size_t cacheSizeLimit, const hades_ir_cache_key* key)
+{
+    static atomic_uint tmpCounter;
+    char path[4096], tmpPath[4200];
+    FILE* file;
+    int ok;
+
+    if(cacheDir==NULL || cacheDir[0]=='\0' || irs==NULL)
+        return 0;
+
+    /* Written to a temporary file first, and then renamed, so that other instances never see a partial entry */
+    hades_ir_cache_getPath(cacheDir, key, path, sizeof(path));
+    snprintf(tmpPath, sizeof(tmpPath), "%s.%lu.%u.tmp", path, (unsigned long)hades_getProcessId(), atomic_fetch_add(&tmpCounter, 1u));
+    if((file = fopen(tmpPath, "wb"))==NULL)
+        return 0;
+    ok = hades_ir_set_writeCacheEntry(file, irs, key, NULL);
+    ok = (fclose(file)==0) && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tmpPath, path)==0;
+#endif
+    if(!ok)
+        remove(tmpPath);
+    else
+        hades_ir_cache_evict(cacheDir, cacheSizeLimit, &path[strlen(cacheDir)+1]);
+    return ok;
+}
+
+SAF_SOFA_ERROR_CODES hades_ir_set_load
+(
+    hades_ir_set** const phIRs,
+    char* path,
+    const char* cacheDir,
+    size_t cacheSizeLimit,
+    const hades_ir_cache_key* key,
+    hades_progress* const progress
+)
+{
+    SAF_SOFA_ERROR_CODES error;
+    int useCache;
+
+    /* The default HRIRs are small enough to be converted on every load */
+    if(path==NULL){
+        hades_ir_set_create(phIRs, __default_N_hrir_dirs, NUM_EARS, __default_hrir_len, (float)__default_hrir_fs,
+                            (const float*)__default_hrir_dirs_deg, (const float*)__default_hrirs);
+        hades_ir_set_resample(*phIRs, key->fs, progress);
+        return SAF_SOFA_OK;
+    }
+
+    /* Cache look-up */
+    useCache = cacheDir!=NULL && cacheDir[0]!='\0';
+    if(useCache && hades_ir_set_loadCache(phIRs, cacheDir, key))
+        return SAF_SOFA_OK;
+
+    /* Otherwise, load the SOFA file (converting it to the host sample rate), and add it to the cache for next time. The
+     * grid is decimated before the conversion (which then has fewer directions to convert), and the IRs are truncated
+     * after it (so that the ringing of the conversion filters is trimmed along with the rest) */
+    error = hades_ir_set_loadSofa(phIRs, path);
+    if(error==SAF_SOFA_OK){
+        hades_ir_set_decimate(*phIRs, key->reduction.targetNumDirs, key->reduction.maxSteeringError_dB);
+        hades_ir_set_resample(*phIRs, key->fs, progress);
+        if(key->reduction.truncate)
+            hades_ir_set_truncate(*phIRs);
+    }
+    if(error==SAF_SOFA_OK && useCache)
+        hades_ir_set_saveCache(*phIRs, cacheDir, cacheSizeLimit, key);
+    return error;
+}
+
+void hades_ir_set_destroy(hades_ir_set** const phIRs)
+{
+    hades_ir_set* irs = *phIRs;
+
+    if(irs!=NULL){
+        if(irs->mapping!=NULL)
+            hades_file_unmap(irs->mapping, irs->mappingSize);
+        else{
+            free(irs->dirs_deg);
+            free(irs->IRs);
+        }
+        free(irs);
+        (*phIRs) = NULL;
+    }
+}
+
+size_t hades_ir_set_getSize(const hades_ir_set* irs)
+{
+    return irs==NULL ? 0 : sizeof(hades_ir_set) + (size_t)irs->nDirs*2*sizeof(float) +
+                           (size_t)irs->nDirs*irs->nCh*irs->IRlength*sizeof(float);
+}
+
+/** Registry entry states */
+typedef enum {
+    IR_REGISTRY_LOADING,                     /**< Being loaded by the thread that created the entry */
+    IR_REGISTRY_READY,                       /**< Loaded */
+    IR_REGISTRY_FAILED                       /**< Failed to load; removed once its last reference is dropped */
+} IR_REGISTRY_STATE;
+
+/** Registry entry: one shared IR set */
+typedef struct _hades_ir_registry_entry {
+    hades_ir_cache_key key;                  /**< Content hash and configuration */
+    int refCount;                            /**< Number of references (including threads waiting for it to load) */
+    IR_REGISTRY_STATE state;                 /**< see #IR_REGISTRY_STATE */
+    SAF_SOFA_ERROR_CODES error;              /**< Load result */
+    hades_ir_set* irs;                       /**< The IR set; NULL unless READY */
+    struct _hades_ir_registry_entry* next;   /**< Next entry; NULL if last */
+} hades_ir_registry_entry;
+
+/* The registry is a short list guarded by a single lock, which is never held while loading or waiting on anything
+ * else. Threads requesting an entry that is still being loaded wait on 'registryLoaded' */
+static hades_ir_registry_entry* registryEntries = NULL;
+#ifdef _WIN32
+static SRWLOCK registryLock = SRWLOCK_INIT;
+static CONDITION_VARIABLE registryLoaded = CONDITION_VARIABLE_INIT;
+# define REGISTRY_LOCK() AcquireSRWLockExclusive(&registryLock)
+# define REGISTRY_UNLOCK() ReleaseSRWLockExclusive(&registryLock)
+# define REGISTRY_WAIT() SleepConditionVariableSRW(&registryLoaded, &registryLock, INFINITE, 0)
+# define REGISTRY_NOTIFY() WakeAllConditionVariable(&registryLoaded)
+#else
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t registryLoaded = PTHREAD_COND_INITIALIZER;
+# define REGISTRY_LOCK() pthread_mutex_lock(&registryLock)
+# define REGISTRY_UNLOCK() pthread_mutex_unlock(&registryLock)
+# define REGISTRY_WAIT() pthread_cond_wait(&registryLoaded, &registryLock)
+# define REGISTRY_NOTIFY() pthread_cond_broadcast(&registryLoaded)
+#endif
+
+/** Remembered hash of a SOFA file, valid for as long as its size and modification time are unchanged */
+typedef struct _hades_ir_source_hash {
+    char* path;                              /**< File path */
+    uint64_t fileSize;                       /**< File size when hashed, in bytes */
+    int64_t modTime;                         /**< Modification time when hashed */
+    uint64_t hash;                           /**< Hash of the file contents (see hades_ir_set_hashFile()) */
+    struct _hades_ir_source_hash* next;      /**< Next; NULL if last */
+} hades_ir_source_hash;
+
+/* One per distinct path loaded by the process (also guarded by the registry lock, and never freed) */
+static hades_ir_source_hash* sourceHashes = NULL;
+
+/* Returns the hash of a SOFA file, only reading the file if it has changed since it was last hashed (or if it has not
+ * been hashed yet); returns 0 on failure */
+static int hades_ir_registry_hashSource(const char* path, uint64_t* hash)
+{
+    hades_ir_source_hash* entry;
+    uint64_t fileSize;
+    int64_t modTime;
+    int found;
+
+    if(path==NULL || !hades_file_getInfo(path, &fileSize, &modTime))
+        return 0;
+    REGISTRY_LOCK();
+    for(entry = sourceHashes; entry!=NULL && strcmp(entry->path, path)!=0; entry = entry->next);
+    found = entry!=NULL && entry->fileSize==fileSize && entry->modTime==modTime;
+    if(found)
+        (*hash) = entry->hash;
+    REGISTRY_UNLOCK();
+    if(found)
+        return 1;
+
+    /* (hashed with the registry unlocked) */
+    if(!hades_ir_set_hashFile(path, hash))
+        return 0;
+    REGISTRY_LOCK();
+    for(entry = sourceHashes; entry!=NULL && strcmp(entry->path, path)!=0; entry = entry->next);
+    if(entry==NULL){
+        entry = (hades_ir_source_hash*)malloc1d(sizeof(hades_ir_source_hash));
+        entry->path = malloc1d(strlen(path)+1);
+        strcpy(entry->path, path);
+        entry->next = sourceHashes;
+        sourceHashes = entry;
+    }
+    entry->fileSize = fileSize;
+    entry->modTime = modTime;
+    entry->hash = *hash;
+    REGISTRY_UNLOCK();
+    return 1;
+}
+
+/* Drops a reference to an entry, and removes it when it was the last (registry lock must be held) */
+static void hades_ir_registry_unref(hades_ir_registry_entry* entry)
+{
+    hades_ir_registry_entry** link;
+
+    if(--(entry->refCount) > 0)
+        return;
+    for(link = &registryEntries; *link!=entry; link = &(*link)->next);
+    *link = entry->next;
+    hades_ir_set_destroy(&entry->irs);
+    free(entry);
+}
+
+/* Returns the shared IR set for a key, loading it from 'path' (NULL: the default HRIRs) if needed */
+static SAF_SOFA_ERROR_CODES hades_ir_registry_acquireKey
+(
+    hades_ir_set** const phIRs,
+    char* path,
+    const char* cacheDir,
+    size_t cacheSizeLimit,
+    const hades_ir_cache_key* pKey,
+    hades_progress* const progress
+)
+{
+    hades_ir_cache_key key = *pKey;
+    hades_ir_registry_entry* entry;
+    hades_ir_set* irs;
+    SAF_SOFA_ERROR_CODES error;
+
+    (*phIRs) = NULL;
+
+    /* Already loaded (or being loaded) by another instance? */
+    REGISTRY_LOCK();
+    for(entry = registryEntries; entry!=NULL; entry = entry->next){
+        if(memcmp(&entry->key, &key, sizeof(key))==0 && entry->state!=IR_REGISTRY_FAILED)
+            break;
+    }
+    if(entry!=NULL){
+        entry->refCount++;
+        while(entry->state==IR_REGISTRY_LOADING)
+            REGISTRY_WAIT();
+        error = entry->error;
+        if(entry->state==IR_REGISTRY_READY)
+            (*phIRs) = entry->irs;
+        else
+            hades_ir_registry_unref(entry);
+        REGISTRY_UNLOCK();
+        return error;
+    }
+
+    /* If not, then this thread loads it (with the registry unlocked) */
+    entry = (hades_ir_registry_entry*)malloc1d(sizeof(hades_ir_registry_entry));
+    entry->key = key;
+    entry->refCount = 1;
+    entry->state = IR_REGISTRY_LOADING;
+    entry->irs = NULL;
+    entry->next = registryEntries;
+    registryEntries = entry;
+    REGISTRY_UNLOCK();
+    error = hades_ir_set_load(&irs, path, cacheDir, cacheSizeLimit, &key, progress);
+    REGISTRY_LOCK();
+    entry->error = error;
+    if(error==SAF_SOFA_OK){
+        entry->state = IR_REGISTRY_READY;
+        entry->irs = irs;
+        (*phIRs) = irs;
+    }
+    else{
+        entry->state = IR_REGISTRY_FAILED;
+        hades_ir_registry_unref(entry);
+    }
+    REGISTRY_NOTIFY();
+    REGISTRY_UNLOCK();
+    return error;
+}
+
+SAF_SOFA_ERROR_CODES hades_ir_registry_acquire
+(
+    hades_ir_set** const phIRs,
+    char* path,
+    const char* cacheDir,
+    size_t cacheSizeLimit,
+    float fs,
+    const hades_ir_reduction* reduction,
+    hades_progress* const progress
+)
+{
+    hades_ir_cache_key key;
+
+    (*phIRs) = NULL;
+    memset(&key, 0, sizeof(key)); /* (also clears any padding, as keys are compared bytewise) */
+    key.fs = fs;
+    if(reduction!=NULL){
+        key.reduction.truncate = reduction->truncate ? 1 : 0;
+        key.reduction.targetNumDirs = SAF_MAX(reduction->targetNumDirs, 0);
+        /* (the bound only affects the result if there is a decimation, so is otherwise left out of the key) */
+        key.reduction.maxSteeringError_dB = key.reduction.targetNumDirs>0 ? reduction->maxSteeringError_dB : 0.0f;
+    }
+    if(!hades_ir_registry_hashSource(path, &key.sourceHash))
+        return SAF_SOFA_ERROR_INVALID_FILE_OR_FILE_PATH;
+    return hades_ir_registry_acquireKey(phIRs, path, cacheDir, cacheSizeLimit, &key, progress);
+}
+
+void hades_ir_registry_acquireDefaultHRIRs
+(
+    hades_ir_set** const phIRs,
+    float fs,
+    hades_progress* const progress
+)
+{
+    hades_ir_cache_key key;
+
+    memset(&key, 0, sizeof(key));
+    key.sourceHash = IR_SOURCE_DEFAULT_HRIRS;
+    key.fs = fs;
+    hades_ir_registry_acquireKey(phIRs, NULL, NULL, 0, &key, progress); /* (never fails) */
+}
+
+void hades_ir_registry_replace(hades_ir_set** const slot, hades_ir_set* const irs)
+{
+    hades_ir_registry_entry* entry;
+    hades_ir_set* prev;
+
+    REGISTRY_LOCK();
+    prev = *slot;
+    (*slot) = irs;
+    if(prev!=NULL){
+        for(entry = registryEntries; entry!=NULL && entry->irs!=prev; entry = entry->next);
+        saf_assert(entry!=NULL, "IR set was not acquired from the registry");
+        if(entry!=NULL)
+            hades_ir_registry_unref(entry);
+    }
+    REGISTRY_UNLOCK();
+}
+
+void hades_ir_registry_getUsage
+(
+    hades_ir_set** const* slots,
+    int nSlots,
+    size_t* sharedBytes,
+    size_t* privateBytes
+)
+{
+    hades_ir_registry_entry* entry;
+    hades_ir_set* irs;
+    int i;
+
+    (*sharedBytes) = (*privateBytes) = 0;
+    REGISTRY_LOCK(); /* (the slots are only ever changed under this lock) */
+    for(i=0; i<nSlots; i++){
+        if((irs = *slots[i])==NULL)
+            continue;
+        for(entry = registryEntries; entry!=NULL && entry->irs!=irs; entry = entry->next);
+        if(entry!=NULL && entry->refCount>1)
+            (*sharedBytes) += hades_ir_set_getSize(irs);
+        else
+            (*privateBytes) += hades_ir_set_getSize(irs);
+    }
+    REGISTRY_UNLOCK();
+}
+
+void hades_ir_registry_getTotalUsage
+(
+    int* nSets,
+    size_t* residentBytes,
+    size_t* referencedBytes
+)
+{
+    hades_ir_registry_entry* entry;
+
+    (*nSets) = 0;
+    (*residentBytes) = (*referencedBytes) = 0;
+    REGISTRY_LOCK();
+    for(entry = registryEntries; entry!=NULL; entry = entry->next){
+        if(entry->state!=IR_REGISTRY_READY)
+            continue;
+        (*nSets)++;
+        (*residentBytes) += hades_ir_set_getSize(entry->irs);
+        (*referencedBytes) += (size_t)entry->refCount*hades_ir_set_getSize(entry->irs);
+    }
+    REGISTRY_UNLOCK();
+}
+
+void* hades_file_map(const char* path, size_t* size)
+{
+    void* mapping;
+#ifdef _WIN32
+    HANDLE file, section;
+    LARGE_INTEGER fileSize;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file==INVALID_HANDLE_VALUE)
+        return NULL;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart==0){
+        CloseHandle(file);
+        return NULL;
+    }
+    section = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if(section==NULL)
+        return NULL;
+    mapping = MapViewOfFile(section, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(section); /* (the view keeps the mapping alive) */
+    (*size) = (size_t)fileSize.QuadPart;
+    return mapping;
+#else
+    int fd;
+    struct stat st;
+
+    if((fd = open(path, O_RDONLY))<0)
+        return NULL;
+    if(fstat(fd, &st)!=0 || st.st_size==0){
+        close(fd);
+        return NULL;
+    }
+    /* Private (copy-on-write) pages, so that nothing can be written back to the file */
+    mapping = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); /* (the mapping stays valid) */
+    if(mapping==MAP_FAILED)
+        return NULL;
+    (*size) = (size_t)st.st_size;
+    return mapping;
+#endif
+}
+
+int hades_file_getInfo(const char* path, uint64_t* size, int64_t* modTime)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+
+    if(!GetFileAttributesExA(path, GetFileExInfoStandard, &info) || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        return 0;
+    (*size) = ((uint64_t)info.nFileSizeHigh<<32) | info.nFileSizeLow;
+    (*modTime) = (int64_t)(((uint64_t)info.ftLastWriteTime.dwHighDateTime<<32) | info.ftLastWriteTime.dwLowDateTime);
+#else
+    struct stat st;
+
+    if(stat(path, &st)!=0 || !S_ISREG(st.st_mode))
+        return 0;
+    (*size) = (uint64_t)st.st_size;
+    (*modTime) = (int64_t)st.st_mtime;
+#endif
+    return 1;
+}
+
+void hades_file_unmap(void* mapping, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(mapping);
+#else
+    munmap(mapping, size);
+#endif
+}
+
+unsigned long hades_getProcessId(void)
+{
+#ifdef _WIN32
+    return (unsigned long)GetCurrentProcessId();
+#else
+    return (unsigned long)getpid();
+#endif
+}
+
+int hades_getNumProcessors(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return SAF_MAX(1, (int)info.dwNumberOfProcessors);
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n>0 ? (int)n : 1;
+#endif
+}
+
+double hades_getWallTime_ms(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return 1000.0*(double)counter.QuadPart/(double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1000.0*(double)ts.tv_sec + (double)ts.tv_nsec/1.0e6;
+#endif
+}
+
+double hades_getThreadCpuTime_ms(void)
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if(!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return 0.0;
+    /* (in units of 100 ns) */
+    return ((double)(((uint64_t)kernel.dwHighDateTime<<32) | kernel.dwLowDateTime) +
+            (double)(((uint64_t)user.dwHighDateTime<<32) | user.dwLowDateTime))/1.0e4;
+#else
+    struct timespec ts;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)!=0)
+        return 0.0;
+    return 1000.0*(double)ts.tv_sec + (double)ts.tv_nsec/1.0e6;
+#endif
+}
+
+size_t hades_getPeakResidentBytes(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    /* (the kernel32 export, so that psapi need not be linked) */
+    if(!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return (size_t)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage)!=0)
+        return 0;
+# ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;       /* (bytes on macOS) */
+# else
+    return (size_t)usage.ru_maxrss*1024;  /* (kilobytes elsewhere) */
+# endif
+#endif
+}
@@ -0,0 +1,97 @@
+clear all, dbstop if error%, close all %#ok 
+% Compares the hierarchical (coarse-to-fine) MUSIC search against the
+% exhaustive one, for simulated single-source + diffuse covariance matrices
+% built from the array measurements, over a range of coarse grid sizes and
+% beam widths. Reported per configuration are: the percentage of estimates
+% that agree with the exhaustive search, the mean angular error relative to the
+% exhaustive estimates, the mean number of pseudo-spectrum evaluations per
+% band, and the speed-up of the search itself
+
+% Change this path to where the external libraries are
+externals_path = '../../resources_/';
+
+% This script requires the following external libraries
+% Obtain from: https://github.com/polarch/Spherical-Harmonic-Transform
+addpath([externals_path 'Spherical-Harmonic-Transform'])
+% Obtain from: https://github.com/jvilkamo/afSTFT
+addpath([externals_path 'afSTFT'])
+
+addpath('./resources_/')
+addpath('./utils/')
+
+%% Configuration 
+load('h_array.mat')
+grid_dirs_deg = grid_dirs_rad*180/pi;
+mic_inds = [1,2,3,4,5,6,7,8];
+nTrials = 200;                        % number of simulated source directions
+diffuseness_values = [0.2 0.5 0.8];   % diffuse-to-total energy ratios of the simulated covariances
+nCoarse_values = [16 32 64 128];      % DOA_SEARCH_NCOARSE
+beamWidth_values = [1 2 3 5];         % DOA_SEARCH_BEAM_WIDTH
+
+analysis_pars.fs = 48e3;
+analysis_pars.hopsize = 128;    
+analysis_pars.blocksize = 512;  
+analysis_pars.grid_dirs_deg = grid_dirs_deg; 
+analysis_pars.h_array = h_array(:,mic_inds,:); 
+analysis_pars.DOA_ESTIMATOR = 'MUSIC'; 
+analysis_pars.DIFFUSENESS_ESTIMATOR = 'SDDIFF';
+analysis_pars.FREQUENCY_AVERAGING_OPTION = 'none';
+analysis_pars.DOA_SEARCH_OPTION = 'exhaustive'; 
+analysis_pars = hades_analysis_init(analysis_pars); 
+nBands = length(analysis_pars.centreFreq);
+nGrid = size(grid_dirs_deg,1);
+nMics = length(mic_inds);
+grid_dirs_xyz = unitSph2cart(grid_dirs_rad);
+
+%% Simulated noise subspaces (diffuse-whitened, as in hades_analysis) 
+rng(1);
+srcIdx = randi(nGrid, nTrials, 1);
+bands = randi(nBands, nTrials, 1);
+W = cell(nTrials, length(diffuseness_values));
+for nt=1:nTrials
+    A_grid = reshape(analysis_pars.H_grid(bands(nt),:,:),[nMics nGrid]); 
+    a = A_grid(:,srcIdx(nt));
+    DFC = analysis_pars.DFCmtx(:,:,bands(nt)); 
+    [U,E] = eig(DFC); [~,ind] = sort(real(diag(E)),'descend'); 
+    T = sqrt(pinv(E(ind,ind)))*U(:,ind)';
+    for nd=1:length(diffuseness_values)
+        psi = diffuseness_values(nd);
+        Cx = (1-psi)*(a*a')./real(a'*a) + psi*DFC./real(trace(DFC)); 
+        [V,S] = eig(T*Cx*T'); [~,ind] = sort(real(diag(S)),'descend'); 
+        W{nt,nd} = T'*V(:,ind(2:end));
+    end
+end
+
+%% Exhaustive search (reference)
+ref_idx = zeros(nTrials, length(diffuseness_values));
+tic
+for nd=1:length(diffuseness_values)
+    for nt=1:nTrials
+        A_grid = reshape(analysis_pars.H_grid(bands(nt),:,:),[nMics nGrid]); 
+        [~,ref_idx(nt,nd)] = max(1./sum(abs(W{nt,nd}'*A_grid).^2,1));
+    end
+end
+time_exhaustive = toc;
+fprintf('exhaustive: %d directions, %.3f ms per search\n', nGrid, 1e3*time_exhaustive/numel(ref_idx));
+
+%% Hierarchical search
+fprintf('%8s %6s %10s %10s %10s %9s %9s\n', 'nCoarse', 'beam', 'psi', 'agree(%)', 'err(deg)', 'nEvals', 'speed-up');
+for nc=1:length(nCoarse_values)
+    for nb=1:length(beamWidth_values)
+        search = buildDoAsearchHierarchy(grid_dirs_deg, nCoarse_values(nc), 4, beamWidth_values(nb));
+        for nd=1:length(diffuseness_values)
+            est_idx = zeros(nTrials,1);
+            nEvals = zeros(nTrials,1);
+            tic
+            for nt=1:nTrials
+                A_grid = reshape(analysis_pars.H_grid(bands(nt),:,:),[nMics nGrid]); 
+                [est_idx(nt), nEvals(nt)] = hierarchicalMUSIC(A_grid, W{nt,nd}, search);
+            end
+            time_hierarchical = toc;
+            angle_err = acos(min(max(dot(grid_dirs_xyz(est_idx,:), grid_dirs_xyz(ref_idx(:,nd),:), 2),-1),1))*180/pi;
+            fprintf('%8d %6d %10.2f %10.1f %10.2f %9.1f %9.2f\n', nCoarse_values(nc), beamWidth_values(nb), ...
+                diffuseness_values(nd), 100*mean(est_idx==ref_idx(:,nd)), mean(angle_err), mean(nEvals), ...
+                (time_exhaustive/length(diffuseness_values))/time_hierarchical);
+        end
+    end
+end
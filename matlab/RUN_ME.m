@@ -75,7 +75,19 @@ scene_name = 'h_array.mat_medium_8  2_4+4';
 %   analysis_pars.grid_dirs_deg              directions for each measurement, in degrees; nMeasurements x 2 
 %   analysis_pars.h_array:                   time-domain array measurements; filterLength x nChannels x nMeasurements 
 %   analysis_pars.DOA_ESTIMATOR:             {'MUSIC'}
+%   analysis_pars.DOA_SEARCH_OPTION:         {'exhaustive', 'hierarchical'}
+%     exhaustive:   the pseudo-spectrum is evaluated for every measurement direction
+%     hierarchical: the pseudo-spectrum is evaluated for a coarse subset of the measurement directions, and then refined 
+%                   around the best candidates (see buildDoAsearchHierarchy and BENCHMARK_DOA_SEARCH.m)
+%   analysis_pars.DOA_SEARCH_NCOARSE:        number of directions scanned at the coarsest level (Only used if 'hierarchical')
+%   analysis_pars.DOA_SEARCH_BEAM_WIDTH:     number of candidates refined per level (Only used if 'hierarchical')
 %   analysis_pars.DIFFUSENESS_ESTIMATOR:     {'SDDIFF'}
+%   analysis_pars.SUBSPACE_OPTION:           {'evd', 'tracking'}
+%     evd:      the eigenvectors and eigenvalues of the (whitened) SCM are obtained via a full EVD, per band and hop
+%     tracking: they are tracked via one step of orthogonal iteration per hop, warm-started from the previous hop, 
+%               and a full EVD is only conducted periodically, or when the tracking error grows
+%   analysis_pars.SUBSPACE_EVD_PERIOD:       maximum number of hops between full EVDs (Only used if 'tracking')
+%   analysis_pars.SUBSPACE_TRACKING_TOL:     relative eigen-residual that triggers a full EVD (Only used if 'tracking')
 %   analysis_pars.FREQUENCY_AVERAGING_OPTION: {'none', 'octave', 'ERB', 'broad_band} (Only used if steering_direction_deg = 'DoA')
 %     none:       the estimated parameters are not averaged over frequency
 %     octave:     the estimated parameters are averaged over frequency bands grouped according to octave bands
@@ -89,7 +101,13 @@ analysis_pars.blocksize = 512;
 analysis_pars.grid_dirs_deg = grid_dirs_deg; 
 analysis_pars.h_array = h_array(:,[left_inds right_inds],:); 
 analysis_pars.DOA_ESTIMATOR = 'MUSIC'; 
+analysis_pars.DOA_SEARCH_OPTION = 'exhaustive'; 
+analysis_pars.DOA_SEARCH_NCOARSE = 64; 
+analysis_pars.DOA_SEARCH_BEAM_WIDTH = 3; 
 analysis_pars.DIFFUSENESS_ESTIMATOR = 'SDDIFF';
+analysis_pars.SUBSPACE_OPTION = 'evd'; 
+analysis_pars.SUBSPACE_EVD_PERIOD = 16; 
+analysis_pars.SUBSPACE_TRACKING_TOL = 0.05; 
 analysis_pars.FREQUENCY_AVERAGING_OPTION = 'none';
 analysis_pars.temporal_avg_coeff = 1 - 1/(4096/analysis_pars.blocksize);% 0.97; % 512: 0.77, 256: 0.92
 
@@ -139,6 +157,10 @@ end
 %   synthesis_pars.hrirs:         HRIR measurements; lHRIR x 2 x nHRIRs (set to [] if no HRIR convolution is wanted)
 %   synthesis_pars.hrir_dirs_deg: HRIR directions; nHRIRs x 2 (not needed if hrirs = [])
 %   synthesis_pars.hrir_fs:       HRIR sample rate (not needed if hrirs = [])
+%   synthesis_pars.HRTF_INTERP_OPTION: {'nearest', 'triangular'}
+%     nearest:    each grid direction uses the HRTF of the closest HRIR direction
+%     triangular: each grid direction uses a VBAP-style weighting of the three enclosing HRIR directions, 
+%                 interpolating the HRTF magnitudes and ITDs separately
 %
 % [2] As' ad, H., Bouchard, M. and Kamkar-Parsi, H., 2019. A robust target
 %     linearly constrained minimum variance beamformer with spatial cues 
@@ -148,7 +170,9 @@ end
 load('hrirs.mat')
 synthesis_pars.ENABLE_COVARIANCE_MATCHING = 1;
 synthesis_pars.SOURCE_BEAMFORMING_OPTION = 'none'; 
-synthesis_pars.hrirs = hrirs(:,:,findClosestGridPoints(hrir_dirs_rad, grid_dirs_rad)); 
+synthesis_pars.hrirs = hrirs; 
+synthesis_pars.hrir_dirs_deg = hrir_dirs_rad*180/pi;
+synthesis_pars.HRTF_INTERP_OPTION = 'nearest';
 synthesis_pars.hrir_fs = h_array_fs;
 synthesis_pars.ref_inds = ref_inds;
 synthesis_pars.temporal_avg_coeff = analysis_pars.temporal_avg_coeff;  
@@ -50,6 +50,8 @@ parameter_container.doa_hist = zeros(nGrid,nBands);
 
 % Main processing loop
 Cx = zeros(nMics,nMics,nBands);
+V_track = zeros(nMics,nMics,nBands);   % tracked eigenvectors per band (if SUBSPACE_OPTION is 'tracking')
+hopsSinceEVD = inf(nBands,1);
 diffuseness = zeros(nBands,1);
 doa_idx = zeros(nBands,1);
 startIndex = 1;
@@ -83,10 +85,19 @@ while startIndex+blocksize <= nBlocks*blocksize
         if applyDiffWhitening==1
             [U,E] = sorted_eig(pars.DFCmtx(:,:,band));
             T = sqrt(pinv(E))*U';    
-            [V,S] = sorted_eig(T*Cx(:,:,band)*T');    
-            %[V,~] = sorted_eig(Cx(:,:,band));
+            COV = T*Cx(:,:,band)*T';    
+            %COV = Cx(:,:,band);
         else
-            [V,S] = sorted_eig(Cx(:,:,band)); 
+            COV = Cx(:,:,band); 
+        end
+        switch pars.SUBSPACE_OPTION
+            case 'evd'
+                [V,S] = sorted_eig(COV);
+            case 'tracking'
+                [V,S,hopsSinceEVD(band)] = tracked_eig(COV, V_track(:,:,band), hopsSinceEVD(band), ...
+                    pars.SUBSPACE_EVD_PERIOD, pars.SUBSPACE_TRACKING_TOL);
+                V_track(:,:,band) = V;
+            otherwise, assert(0);
         end
 
         % Estimate the number of sources (if required)
@@ -102,11 +113,19 @@ while startIndex+blocksize <= nBlocks*blocksize
         switch pars.DOA_ESTIMATOR 
             case 'MUSIC'   
                 A_grid = reshape(pars.H_grid(band,:,:),[nMics nGrid]); 
-                if applyDiffWhitening==1
-                    A_grid = T*A_grid;
-                end
                 Vn = V(:,2:end);  
-                [~,doa_idx(band)] = sdMUSIC(grid_dirs_rad, grid_dirs_xyz, A_grid, 1, Vn); 
+                switch pars.DOA_SEARCH_OPTION
+                    case 'exhaustive'
+                        if applyDiffWhitening==1
+                            A_grid = T*A_grid;
+                        end
+                        [~,doa_idx(band)] = sdMUSIC(grid_dirs_rad, grid_dirs_xyz, A_grid, 1, Vn); 
+                    case 'hierarchical'
+                        % The whitening is folded into the noise subspace instead, so that only the visited steering vectors are touched
+                        if applyDiffWhitening==1, W = T'*Vn; else, W = Vn; end
+                        doa_idx(band) = hierarchicalMUSIC(A_grid, W, pars.doa_search); 
+                    otherwise, assert(0);
+                end
             otherwise, assert(0);
         end
     end
@@ -139,6 +158,27 @@ D = diag(d_sorted);
 V = V(:,idx);
 end
 
+%%%%%%%%%%%%%%%%%%%%%%%
+function [V,D,nHops] = tracked_eig(COV, V_prev, nHops, period, tol)
+% Tracks the eigenvectors of a slowly varying (recursively averaged) covariance matrix, with one step of orthogonal
+% iteration per hop, warm-started from the previous estimate. The eigenvalues are taken as the Rayleigh quotients of 
+% the previous eigenvectors. A full EVD is instead conducted every "period" hops, or whenever the relative residual 
+% of the previous eigenvectors exceeds "tol"
+nHops = nHops+1;
+if nHops<period
+    CV = COV*V_prev;
+    d = real(sum(conj(V_prev).*CV,1)); 
+    if norm(CV - V_prev*diag(d), 'fro') <= tol*max(norm(COV, 'fro'), eps)
+        [d_sorted, idx] = sort(d,'descend');
+        [V,~] = qr(CV(:,idx),0);
+        D = diag(d_sorted);
+        return
+    end
+end
+[V,D] = sorted_eig(COV);
+nHops = 0;
+end
+
 %%%%%%%%%%%%%%%%%%%%%%%
 function [est_dirs, est_idx] = sdMUSIC(grid_dirs, grid_xyz, A_grid, nSrc, Vn)
 % Based on sphMUSIC(), written by Archontis Politis
@@ -46,7 +46,24 @@ for nb=1:size(H_grid,1)
 end 
 
 % Initialisations for DoA estimation and source detection 
-...
+if ~isfield(analysis_pars, 'SUBSPACE_OPTION'), analysis_pars.SUBSPACE_OPTION = 'evd'; end
+switch analysis_pars.SUBSPACE_OPTION
+    case 'evd'
+    case 'tracking'
+        if ~isfield(analysis_pars, 'SUBSPACE_EVD_PERIOD'), analysis_pars.SUBSPACE_EVD_PERIOD = 16; end
+        if ~isfield(analysis_pars, 'SUBSPACE_TRACKING_TOL'), analysis_pars.SUBSPACE_TRACKING_TOL = 0.05; end
+    otherwise, assert(0);
+end
+if ~isfield(analysis_pars, 'DOA_SEARCH_OPTION'), analysis_pars.DOA_SEARCH_OPTION = 'exhaustive'; end
+switch analysis_pars.DOA_SEARCH_OPTION
+    case 'exhaustive'
+    case 'hierarchical'
+        if ~isfield(analysis_pars, 'DOA_SEARCH_NCOARSE'), analysis_pars.DOA_SEARCH_NCOARSE = 64; end
+        if ~isfield(analysis_pars, 'DOA_SEARCH_BEAM_WIDTH'), analysis_pars.DOA_SEARCH_BEAM_WIDTH = 3; end
+        analysis_pars.doa_search = buildDoAsearchHierarchy(analysis_pars.grid_dirs_deg, ...
+            analysis_pars.DOA_SEARCH_NCOARSE, 4, analysis_pars.DOA_SEARCH_BEAM_WIDTH);
+    otherwise, assert(0);
+end
 
 % Frequency grouping 
 switch analysis_pars.FREQUENCY_AVERAGING_OPTION
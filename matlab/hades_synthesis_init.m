@@ -16,8 +16,11 @@ function synthesis_pars = hades_synthesis_init(analysis_pars, synthesis_pars)
 % License.
 %
 
-% Assumes that the hrtfs have been measured (or at least interpolated) to
-% have the same grid as the array grid
+% If synthesis_pars.hrir_dirs_deg is given, then the HRTFs are obtained for
+% the array grid directions using synthesis_pars.HRTF_INTERP_OPTION
+% ({'nearest' (default), 'triangular'}, see interpHRTFsToGrid). Otherwise,
+% it is assumed that the hrtfs have been measured (or at least interpolated)
+% to have the same grid as the array grid
 
 %%% Copy parameters relavant to the synthesis struct from the analysis struct 
 synthesis_pars.hopsize = analysis_pars.hopsize;
@@ -34,6 +37,17 @@ assert(size(synthesis_pars.grid_dirs_deg,1)==size(synthesis_pars.H_grid,3));
 hrtfs = afSTFTprocessFIRs(synthesis_pars.hrirs, synthesis_pars.hopsize, analysis_pars.LDmode, analysis_pars.hybridMode);  
 
 % Interpolate so that the HRIR grid is the same as the scanning grid 
+if isfield(synthesis_pars, 'hrir_dirs_deg') && ~isempty(synthesis_pars.hrir_dirs_deg)
+    if ~isfield(synthesis_pars, 'HRTF_INTERP_OPTION'), synthesis_pars.HRTF_INTERP_OPTION = 'nearest'; end
+    if strcmpi(synthesis_pars.HRTF_INTERP_OPTION, 'triangular')
+        itds = computeITDfromXCorr(synthesis_pars.hrirs, synthesis_pars.hrir_fs);
+    else
+        itds = [];
+    end
+    hrtfs = interpHRTFsToGrid(hrtfs, itds, synthesis_pars.hrir_dirs_deg, synthesis_pars.grid_dirs_deg, ...
+        synthesis_pars.centreFreq, synthesis_pars.HRTF_INTERP_OPTION);
+end
+assert(size(hrtfs,3)==size(synthesis_pars.grid_dirs_deg,1));
 synthesis_pars.hrtfs = permute(hrtfs, [2 3 1]);
  
 end
@@ -0,0 +1,73 @@
+function search = buildDoAsearchHierarchy(grid_dirs_deg, nCoarse, levelRatio, beamWidth)
+% Builds a multi-resolution neighbourhood graph over a (measurement) grid, for
+% a coarse-to-fine search of the MUSIC pseudo-spectrum (see hierarchicalMUSIC)
+%   grid_dirs_deg: grid directions; nGrid x 2
+%   nCoarse:       number of directions scanned at the coarsest level
+%   levelRatio:    growth in the number of directions from one level to the
+%                  next (>1)
+%   beamWidth:     number of top candidates that are refined at each level
+%
+% The grid is ordered by farthest-point sampling, such that the first n
+% directions cover it as evenly as possible for any n, and each level is then
+% the first nCoarse*levelRatio^(k-1) of them (the last level being the whole
+% grid). The children of a direction are the directions of the next level that
+% lie within the covering radius of its own level (i.e. the largest angle
+% between any grid direction and its closest direction of that level), so the
+% grid direction with the highest pseudo-spectrum value is always among the
+% children of its closest direction one level up.
+%
+% This file is part of HADES
+% Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+%
+% HADES is free software; you can redistribute it and/or modify it under the
+% terms of the GNU General Public License as published by the Free Software
+% Foundation; either version 2 of the License, or (at your option) any later
+% version.
+%
+% HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+% WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+% A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+%
+% See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+% License.
+%
+
+nGrid = size(grid_dirs_deg,1);
+xyz = unitSph2cart(grid_dirs_deg*pi/180);
+assert(levelRatio>1, 'levelRatio must be greater than 1')
+
+% Farthest-point ordering of the grid
+order = zeros(nGrid,1);
+order(1) = 1;
+maxCos = -2*ones(nGrid,1); % cosine of the angle to the closest direction ordered so far
+for i=2:nGrid
+    maxCos = max(maxCos, xyz*xyz(order(i-1),:).');
+    maxCos(order(1:i-1)) = inf;
+    [~,order(i)] = min(maxCos);
+end
+
+% Levels (nested subsets of the ordered grid)
+nDirsLevel = min(max(round(nCoarse),1), nGrid);
+while nDirsLevel(end)<nGrid
+    nDirsLevel(end+1) = min(ceil(nDirsLevel(end)*levelRatio), nGrid); %#ok
+end
+nLevels = length(nDirsLevel);
+search.levels = cell(nLevels,1);
+for k=1:nLevels
+    search.levels{k} = order(1:nDirsLevel(k));
+end
+
+% Children of each direction of one level, among the directions of the next
+search.children = cell(nLevels-1,1);
+for k=1:nLevels-1
+    cosToLevel = xyz*xyz(search.levels{k},:).'; % nGrid x nDirsLevel(k)
+    coverRadiusCos = min(max(cosToLevel,[],2)); % (cosine of the covering radius)
+    next = search.levels{k+1};
+    search.children{k} = cell(nGrid,1);
+    for j=1:nDirsLevel(k)
+        search.children{k}{search.levels{k}(j)} = next(cosToLevel(next,j) >= coverRadiusCos-1e-6);
+    end
+end
+search.beamWidth = max(round(beamWidth),1);
+
+end
@@ -0,0 +1,56 @@
+function [est_idx, nEvaluated] = hierarchicalMUSIC(A_grid, W, search)
+% Coarse-to-fine search for the peak of the MUSIC pseudo-spectrum, over a grid
+% prepared with buildDoAsearchHierarchy
+%   A_grid:     steering vectors of the grid; nMics x nGrid
+%   W:          noise subspace (whitened, if the steering vectors are to be,
+%               i.e. T'*Vn); nMics x (nMics-nSrc)
+%   search:     see buildDoAsearchHierarchy
+%   est_idx:    index of the estimated direction, into the grid
+%   nEvaluated: number of grid directions at which the pseudo-spectrum was
+%               evaluated (nGrid for an exhaustive search)
+%
+% The pseudo-spectrum is evaluated at every direction of the coarsest level,
+% and then only at the children of the search.beamWidth best candidates of each
+% level, down to the full grid. A wider beam is slower, but is less likely to
+% follow a local peak (e.g. when there is more than one source).
+%
+% This file is part of HADES
+% Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+%
+% HADES is free software; you can redistribute it and/or modify it under the
+% terms of the GNU General Public License as published by the Free Software
+% Foundation; either version 2 of the License, or (at your option) any later
+% version.
+%
+% HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+% WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+% A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+%
+% See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+% License.
+%
+
+nGrid = size(A_grid,2);
+P_music = nan(nGrid,1); % (NaN: not evaluated)
+
+% Coarsest level
+candidates = search.levels{1};
+P_music(candidates) = pseudoSpectrum(A_grid(:,candidates), W);
+
+% Refine around the best candidates of each level
+for k=1:length(search.children)
+    [~,ind] = sort(P_music(candidates),'descend');
+    top = candidates(ind(1:min(search.beamWidth,end)));
+    candidates = unique(vertcat(search.children{k}{top}));
+    new = candidates(isnan(P_music(candidates)));
+    P_music(new) = pseudoSpectrum(A_grid(:,new), W);
+end
+[~,ind] = max(P_music(candidates));
+est_idx = candidates(ind);
+nEvaluated = sum(~isnan(P_music));
+
+end
+
+function P = pseudoSpectrum(A, W)
+P = 1./real(sum(abs(W'*A).^2,1)).';
+end
@@ -0,0 +1,80 @@
+function hrtfs_grid = interpHRTFsToGrid(hrtfs, itds, hrir_dirs_deg, grid_dirs_deg, centreFreq, INTERP_OPTION)
+% Obtains filterbank-domain HRTFs for the directions of a (scanning) grid
+%   hrtfs:         HRTFs in the filterbank domain; nBands x 2 x nHRIRs
+%   itds:          HRIR interaural time differences, in seconds; nHRIRs x 1
+%                  (see computeITDfromXCorr; only needed for 'triangular')
+%   hrir_dirs_deg: HRIR directions; nHRIRs x 2
+%   grid_dirs_deg: grid directions; nGrid x 2
+%   centreFreq:    filterbank centre frequencies, in Hz; nBands x 1
+%   INTERP_OPTION: {'nearest', 'triangular'}
+%     nearest:     HRTF of the closest HRIR direction
+%     triangular:  the three HRIR directions enclosing each grid direction
+%                  (triangulated via their convex hull) are weighted with
+%                  VBAP-style gains, normalised to sum to one. The magnitudes
+%                  and ITDs are interpolated separately, and the phases are
+%                  then reconstructed from the interpolated ITDs
+%
+% This file is part of HADES
+% Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+%
+% HADES is free software; you can redistribute it and/or modify it under the
+% terms of the GNU General Public License as published by the Free Software
+% Foundation; either version 2 of the License, or (at your option) any later
+% version.
+%
+% HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+% WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+% A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+%
+% See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+% License.
+%
+
+nGrid = size(grid_dirs_deg,1);
+hrir_dirs_rad = hrir_dirs_deg*pi/180;
+grid_dirs_rad = grid_dirs_deg*pi/180;
+
+switch lower(INTERP_OPTION)
+    case 'nearest'
+        hrtfs_grid = hrtfs(:,:,findClosestGridPoints(hrir_dirs_rad, grid_dirs_rad));
+        
+    case 'triangular'
+        % Triangulate the HRIR directions, and find the triangle enclosing
+        % each grid direction (the one for which all three gains are positive)
+        hrir_xyz = unitSph2cart(hrir_dirs_rad);
+        grid_xyz = unitSph2cart(grid_dirs_rad);
+        tri = convhulln(hrir_xyz);
+        gains = zeros(nGrid,3);
+        idx = zeros(nGrid,3);
+        unassigned = true(nGrid,1);
+        for nt=1:size(tri,1)
+            g = grid_xyz/hrir_xyz(tri(nt,:),:);
+            inside = unassigned & all(g>-1e-5, 2);
+            gains(inside,:) = g(inside,:);
+            idx(inside,:) = repmat(tri(nt,:), sum(inside), 1);
+            unassigned(inside) = false;
+        end
+        assert(~any(unassigned), 'The HRIR directions do not enclose all of the grid directions');
+        gains = max(gains,0);
+        gains = gains./repmat(sum(gains,2),1,3);
+        
+        % Interpolate the magnitudes and ITDs, and then reconstruct the phases
+        % (positive ITDs: source on the left, i.e. the right ear lags)
+        nBands = size(hrtfs,1);
+        hrtfs_grid = zeros(nBands, 2, nGrid);
+        for ng=1:nGrid
+            mags = zeros(nBands,2);
+            for k=1:3
+                mags = mags + gains(ng,k).*abs(hrtfs(:,:,idx(ng,k)));
+            end
+            itd = gains(ng,:)*itds(idx(ng,:));
+            ipd = 2*pi*centreFreq(:)*itd;
+            hrtfs_grid(:,1,ng) = mags(:,1).*exp( 1i*ipd/2);
+            hrtfs_grid(:,2,ng) = mags(:,2).*exp(-1i*ipd/2);
+        end
+        
+    otherwise
+        error('Unknown INTERP_OPTION');
+end
+
+end
@@ -0,0 +1,474 @@
+/*
+ * This file is part of HADES
+ * Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+ *
+ * HADES is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+ * License.
+ */
+
+/*
+ * hades_init_bench: measures how long hades_renderer_initCodec() takes to load
+ * a given set of SOFA files, the CPU time it takes (including the worker
+ * threads), and how much it raises the peak resident memory. Each run is made
+ * in a fresh child process, so that the peak memory of one run is not hidden
+ * by that of an earlier one. The first run is "cold" (unless the cache
+ * directory already holds the IR sets), and any subsequent runs are "warm". The
+ * time spent on each initialisation phase is then broken down (see
+ * hades_renderer_getInitProfile()).
+ *
+ * If several microphone array SOFA files are given (e.g. arrays with different
+ * numbers of sensors, measurement directions, or IR lengths), then each one is
+ * benchmarked in turn, and a summary table compares them. With --sweep, each
+ * array is also benchmarked with its grid decimated to 1/2, 1/4 and 1/8 of its
+ * directions, and with and without IR truncation.
+ *
+ * With --latency, the time taken to pick up a settings change (from the setter
+ * to the new configuration being ready, with the initialisation service and an
+ * audio thread running) and to destroy an instance are also measured; the
+ * former is split into the initialisation itself, and the hand-over around it.
+ *
+ * With --hrtf-interp-sweep, the HRTF table is then rebuilt with each of the
+ * HRTF interpolation options, reporting the time taken. The memory each option
+ * takes is measured as the resident memory after initialising with it, in a
+ * fresh process per option (so the options only differ by their tables).
+ */
+
+#include "ehades.h"
+#include "process_stats.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+# define popen _popen
+# define pclose _pclose
+#endif
+
+namespace
+{
+    struct Options {
+        std::vector<std::string> mairPaths;     /* microphone array IRs (.sofa), one or more */
+        std::string hrirPath;                   /* HRIRs (.sofa); default HRIRs if empty */
+        std::string cacheDir;                   /* on-disk IR cache; disabled if empty */
+        int enableIRtruncation = 0;
+        int targetNDirs = 0;                    /* 0: all array IR directions */
+        int hrtfInterp = 0;                     /* (internal) HRTF interpolation option; 0: the default */
+        int sampleRate = 48000;
+        int nRuns = 5;
+        bool sweep = false;
+        bool latency = false;
+        bool interpSweep = false;
+        bool childRun = false;                  /* (internal) make one run of the first array, and print its results */
+    };
+
+    void printUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: hades_init_bench --mair <array.sofa> [--mair <array2.sofa> ...] [options]\n"
+            "\n"
+            "Options:\n"
+            "  --hrir <file>        HRIRs (.sofa); the built-in set is used if omitted\n"
+            "  --cache-dir <dir>    Enable the on-disk IR cache, using <dir>\n"
+            "  --ir-trunc <0|1>     Trim the near-silence from the array IRs (default 0)\n"
+            "  --ndirs <n>          Decimate the array IR grid to about <n> directions\n"
+            "  --fs <rate>          Host sample rate (default 48000)\n"
+            "  --runs <n>           Number of initialisations (default 5)\n"
+            "  --sweep              Also decimate each array grid to 1/2, 1/4 and 1/8 of its\n"
+            "                       directions, each with and without IR truncation\n"
+            "  --latency            Also time the reinitialisation and destruction hand-overs\n"
+            "  --hrtf-interp-sweep  Also time the HRTF table for each interpolation option\n");
+    }
+
+    /** Profile of one initialisation of one array */
+    struct Run {
+        double elapsed_ms;
+        double cpuTime_ms;                      /* all threads of the process */
+        size_t peakMemoryIncrease;              /* over the peak before the run */
+        size_t residentBytes;                   /* resident memory of the process after the run */
+        int nMics, nDirs, IRlength;
+        hades_renderer_init_profile profile;
+    };
+
+    /** Results for one microphone array */
+    struct ArrayResult {
+        std::string mairPath;
+        int enableIRtruncation, targetNDirs;    /* options it was run with */
+        int nMics, nDirs, IRlength;
+        std::vector<Run> runs;                  /* the first one is the cold run */
+    };
+
+    const char* const phaseNames[HADES_RENDERER_NUM_INIT_PHASES] = {
+        "array IRs", "analysis", "radial editor", "containers", "HRIRs", "synthesis", "publish"
+    };
+
+    /** Returns the median of 'values' (which must not be empty) */
+    double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[(values.size() - 1)/2];
+    }
+
+    /** Returns the median over the warm runs (or the cold run, if it is the only one) */
+    template<typename Getter>
+    double warmMedian(const std::vector<Run>& runs, Getter get)
+    {
+        std::vector<double> values;
+        for(size_t i=runs.size() > 1 ? 1 : 0; i<runs.size(); i++)
+            values.push_back(get(runs[i]));
+        return median(values);
+    }
+
+    /** Creates an instance with the given options and array (ready for hades_renderer_initCodec()) */
+    void* createInstance(const Options& opts, const std::string& mairPath)
+    {
+        void* hHdR = nullptr;
+        hades_renderer_create(&hHdR);
+        hades_renderer_setSofaFilePathMAIR(hHdR, mairPath.c_str());
+        if(!opts.hrirPath.empty()){
+            hades_renderer_setSofaFilePathHRIR(hHdR, opts.hrirPath.c_str());
+            hades_renderer_setUseDefaultHRIRsflag(hHdR, 0);
+        }
+        hades_renderer_setCacheDirectory(hHdR, opts.cacheDir.c_str());
+        hades_renderer_setEnableIRtruncation(hHdR, opts.enableIRtruncation);
+        hades_renderer_setTargetNDirsArray(hHdR, opts.targetNDirs);
+        if(opts.hrtfInterp != 0)
+            hades_renderer_setHRTFinterpMode(hHdR, (HADES_RENDERER_HRTF_INTERP_OPTIONS)opts.hrtfInterp);
+        hades_renderer_init(hHdR, opts.sampleRate);
+        return hHdR;
+    }
+
+    /** Child process: makes one run, and prints its results on one line (see readRun()) */
+    int childRun(const Options& opts)
+    {
+        void* hHdR = createInstance(opts, opts.mairPaths[0]);
+        const size_t peakBefore = getPeakResidentBytes();
+        const double cpuBefore = getProcessCpuTime_ms();
+        const auto start = std::chrono::steady_clock::now();
+        hades_renderer_initCodec(hHdR);
+        const double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const double cpuTime_ms = getProcessCpuTime_ms() - cpuBefore;
+        const size_t peakAfter = getPeakResidentBytes();
+        if(hades_renderer_getCodecStatus(hHdR) != CODEC_STATUS_INITIALISED){
+            hades_renderer_destroy(&hHdR);
+            return EXIT_FAILURE;
+        }
+        hades_renderer_init_profile profile;
+        hades_renderer_getInitProfile(hHdR, &profile);
+        std::printf("run %.17g %.17g %zu %d %d %d %.17g %.17g %zu", elapsed_ms, cpuTime_ms,
+                    peakAfter > peakBefore ? peakAfter - peakBefore : 0, hades_renderer_getNmicsArray(hHdR),
+                    hades_renderer_getNDirsArray(hHdR), hades_renderer_getIRlengthArray(hHdR), profile.wallTime_ms,
+                    profile.cpuTime_ms, profile.peakMemoryIncrease);
+        for(const hades_renderer_init_phase_profile& p : profile.phases)
+            std::printf(" %d %.17g %.17g %zu", p.ran, p.wallTime_ms, p.cpuTime_ms, p.peakMemoryIncrease);
+        std::printf(" %zu\n", getResidentBytes());
+        hades_renderer_destroy(&hHdR);
+        return EXIT_SUCCESS;
+    }
+
+    /** Makes one run in a child process (this executable, with --child-run), and reads back its results */
+    bool readRun(const std::string& exePath, const Options& opts, const std::string& mairPath, Run& r)
+    {
+        auto quote = [](const std::string& arg){ return "\"" + arg + "\""; };
+        std::string command = quote(exePath) + " --child-run --mair " + quote(mairPath) +
+                              " --ir-trunc " + std::to_string(opts.enableIRtruncation) +
+                              " --ndirs " + std::to_string(opts.targetNDirs) + " --fs " + std::to_string(opts.sampleRate);
+        if(!opts.hrirPath.empty())
+            command += " --hrir " + quote(opts.hrirPath);
+        if(!opts.cacheDir.empty())
+            command += " --cache-dir " + quote(opts.cacheDir);
+        if(opts.hrtfInterp != 0)
+            command += " --hrtf-interp " + std::to_string(opts.hrtfInterp);
+#ifdef _WIN32
+        command = quote(command); /* (cmd.exe strips the outer quotes) */
+#endif
+        FILE* pipe = popen(command.c_str(), "r");
+        if(pipe == nullptr)
+            return false;
+        std::string output;
+        char buffer[512];
+        while(std::fgets(buffer, sizeof(buffer), pipe) != nullptr)
+            output += buffer;
+        if(pclose(pipe) != 0)
+            return false;
+
+        std::istringstream in(output);
+        std::string tag;
+        in >> tag >> r.elapsed_ms >> r.cpuTime_ms >> r.peakMemoryIncrease >> r.nMics >> r.nDirs >> r.IRlength
+           >> r.profile.wallTime_ms >> r.profile.cpuTime_ms >> r.profile.peakMemoryIncrease;
+        for(hades_renderer_init_phase_profile& p : r.profile.phases)
+            in >> p.ran >> p.wallTime_ms >> p.cpuTime_ms >> p.peakMemoryIncrease;
+        in >> r.residentBytes;
+        return tag == "run" && !in.fail();
+    }
+
+    /** Initialises the codec with the given array 'nRuns' times (each in a fresh process) */
+    bool benchmarkArray(const std::string& exePath, const Options& opts, const std::string& mairPath, ArrayResult& result)
+    {
+        result.mairPath = mairPath;
+        result.enableIRtruncation = opts.enableIRtruncation;
+        result.targetNDirs = opts.targetNDirs;
+        std::printf("\n%s (IR truncation %s, %s)\nrun   init (ms)   CPU, all threads (ms)   peak RSS increase (MiB)\n",
+                    mairPath.c_str(), opts.enableIRtruncation ? "on" : "off",
+                    opts.targetNDirs > 0 ? ("decimated to " + std::to_string(opts.targetNDirs) + " directions").c_str() : "all directions");
+        for(int run=0; run<opts.nRuns; run++){
+            Run r = {};
+            if(!readRun(exePath, opts, mairPath, r)){
+                std::fprintf(stderr, "could not load %s\n", mairPath.c_str());
+                return false;
+            }
+            result.nMics = r.nMics;
+            result.nDirs = r.nDirs;
+            result.IRlength = r.IRlength;
+            result.runs.push_back(r);
+            std::printf("%3d %11.2f %23.2f %25.1f\n", run + 1, r.elapsed_ms, r.cpuTime_ms, (double)r.peakMemoryIncrease/1048576.0);
+        }
+
+        /* Per phase (the CPU time is that of the initialising thread only) */
+        const Run& cold = result.runs[0];
+        std::printf("\n%d sensors, %d directions, %d-sample IRs\n", result.nMics, result.nDirs, result.IRlength);
+        std::printf("phase            cold wall   cold CPU   warm wall   warm CPU   cold peak\n"
+                    "                      (ms)  (ms, own)  (ms, med.) (ms, med.)       (MiB)\n");
+        for(int phase=0; phase<HADES_RENDERER_NUM_INIT_PHASES; phase++){
+            const hades_renderer_init_phase_profile& p = cold.profile.phases[phase];
+            std::printf("%-14s %11.2f %10.2f %11.2f %10.2f %11.1f\n", phaseNames[phase], p.wallTime_ms, p.cpuTime_ms,
+                        warmMedian(result.runs, [phase](const Run& r){ return r.profile.phases[phase].wallTime_ms; }),
+                        warmMedian(result.runs, [phase](const Run& r){ return r.profile.phases[phase].cpuTime_ms; }),
+                        (double)p.peakMemoryIncrease/1048576.0);
+        }
+        std::printf("%-14s %11.2f %10.2f %11.2f %10.2f %11.1f\n", "total", cold.profile.wallTime_ms, cold.profile.cpuTime_ms,
+                    warmMedian(result.runs, [](const Run& r){ return r.profile.wallTime_ms; }),
+                    warmMedian(result.runs, [](const Run& r){ return r.profile.cpuTime_ms; }),
+                    (double)cold.profile.peakMemoryIncrease/1048576.0);
+        return true;
+    }
+
+    /** Compares the arrays, in order of their numbers of sensors, directions and IR lengths */
+    void printSweepSummary(std::vector<ArrayResult> results)
+    {
+        std::sort(results.begin(), results.end(), [](const ArrayResult& a, const ArrayResult& b){
+            if(a.nMics != b.nMics)  return a.nMics < b.nMics;
+            if(a.nDirs != b.nDirs)  return a.nDirs < b.nDirs;
+            return a.IRlength < b.IRlength;
+        });
+        std::printf("\ntrunc  target  nMics  nDirs  IR length   cold (ms)   warm (ms)   warm CPU (ms)   cold peak (MiB)   analysis (ms)   synthesis (ms)   file\n");
+        for(const ArrayResult& result : results){
+            std::printf("%5d %7d %6d %6d %10d %11.2f %11.2f %15.2f %17.1f %15.2f %16.2f   %s\n", result.enableIRtruncation,
+                        result.targetNDirs, result.nMics, result.nDirs, result.IRlength,
+                        result.runs[0].elapsed_ms,
+                        warmMedian(result.runs, [](const Run& r){ return r.elapsed_ms; }),
+                        warmMedian(result.runs, [](const Run& r){ return r.cpuTime_ms; }),
+                        (double)result.runs[0].peakMemoryIncrease/1048576.0,
+                        warmMedian(result.runs, [](const Run& r){ return r.profile.phases[HADES_RENDERER_INIT_PHASE_ANALYSIS].wallTime_ms; }),
+                        warmMedian(result.runs, [](const Run& r){ return r.profile.phases[HADES_RENDERER_INIT_PHASE_SYNTHESIS].wallTime_ms; }),
+                        result.mairPath.c_str());
+        }
+    }
+
+    /**
+     * Measures how long a reinitialisation takes to be picked up and completed
+     * by the initialisation service, while an audio thread keeps processing
+     * (a synthesis-only setting is toggled, so that little work is involved),
+     * and how long destroying an instance takes
+     */
+    void runLatency(const Options& opts, const std::string& mairPath)
+    {
+        const int blockSize = 512;
+        std::vector<double> reinit_ms, handover_ms, destroy_ms;
+
+        for(int run=0; run<opts.nRuns; run++){
+            void* hHdR = createInstance(opts, mairPath);
+            hades_renderer_initCodec(hHdR);
+            const int nInputs = hades_renderer_getNmicsArray(hHdR);
+            hades_renderer_startInitService(hHdR);
+
+            /* Audio thread (silence, in real time) */
+            std::atomic<bool> stop(false);
+            std::thread audio([&](){
+                std::vector<float> in((size_t)nInputs*blockSize, 0.0f), out(2*blockSize);
+                std::vector<float*> inputs(nInputs);
+                float* outputs[2] = { &out[0], &out[blockSize] };
+                for(int ch=0; ch<nInputs; ch++)
+                    inputs[ch] = &in[(size_t)ch*blockSize];
+                while(!stop.load()){
+                    hades_renderer_process(hHdR, inputs.data(), outputs, nInputs, 2, blockSize);
+                    std::this_thread::sleep_for(std::chrono::microseconds(1000000LL*blockSize/opts.sampleRate));
+                }
+            });
+
+            /* Reinitialisation: from the setter returning, to the new configuration being ready */
+            const auto start = std::chrono::steady_clock::now();
+            hades_renderer_setEnableCovMatching(hHdR, !hades_renderer_getEnableCovMatching(hHdR));
+            while(hades_renderer_getCodecStatus(hHdR) != CODEC_STATUS_INITIALISED)
+                std::this_thread::yield();
+            const double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            hades_renderer_init_profile profile;
+            hades_renderer_getInitProfile(hHdR, &profile);
+            reinit_ms.push_back(elapsed_ms);
+            handover_ms.push_back(std::max(elapsed_ms - profile.wallTime_ms, 0.0));
+
+            /* Destruction (once the host has stopped processing, with the service still running) */
+            stop.store(true);
+            audio.join();
+            const auto destroyStart = std::chrono::steady_clock::now();
+            hades_renderer_destroy(&hHdR);
+            destroy_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - destroyStart).count());
+        }
+        std::printf("\nlatency (ms)                       median        max\n");
+        std::printf("reinit (setter to ready)     %12.3f %10.3f\n", median(reinit_ms), *std::max_element(reinit_ms.begin(), reinit_ms.end()));
+        std::printf("  of which hand-over         %12.3f %10.3f\n", median(handover_ms), *std::max_element(handover_ms.begin(), handover_ms.end()));
+        std::printf("destroy                      %12.3f %10.3f\n", median(destroy_ms), *std::max_element(destroy_ms.begin(), destroy_ms.end()));
+    }
+
+    /**
+     * Switches between the HRTF interpolation options on one loaded instance
+     * (only the synthesis, which holds the HRTF table, is rebuilt each time),
+     * and then measures the memory taken with each option in a fresh process
+     */
+    bool runInterpSweep(const std::string& exePath, const Options& opts, const std::string& mairPath)
+    {
+        struct Mode { HADES_RENDERER_HRTF_INTERP_OPTIONS option; const char* name; };
+        const Mode modes[] = { { HADES_RENDERER_HRTF_INTERP_NEAREST, "nearest" },
+                               { HADES_RENDERER_HRTF_INTERP_TRIANGULAR, "triangular" } };
+
+        void* hHdR = createInstance(opts, mairPath);
+        hades_renderer_initCodec(hHdR);
+        std::printf("\nHRTF table: %d grid directions x %d bands x 2 ears (%d HRIR directions)\n",
+                    hades_renderer_getNDirsArray(hHdR), hades_renderer_getNumberOfBands(hHdR), hades_renderer_getNDirsBin(hHdR));
+        std::printf("mode          rebuild (ms, median of %d)   resident after init (MiB)   vs. nearest (MiB)   synthesis peak (MiB)\n",
+                    opts.nRuns);
+        double nearestResident = 0.0;
+        for(const Mode& mode : modes){
+            std::vector<double> modeTimes;
+            for(int run=0; run<opts.nRuns; run++){
+                /* (alternating, so that every run rebuilds the table) */
+                hades_renderer_setHRTFinterpMode(hHdR, mode.option == HADES_RENDERER_HRTF_INTERP_NEAREST ?
+                                                 HADES_RENDERER_HRTF_INTERP_TRIANGULAR : HADES_RENDERER_HRTF_INTERP_NEAREST);
+                hades_renderer_initCodec(hHdR);
+                hades_renderer_setHRTFinterpMode(hHdR, mode.option);
+                const auto start = std::chrono::steady_clock::now();
+                hades_renderer_initCodec(hHdR);
+                modeTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+
+            /* Memory (median over fresh processes, which differ only in the option) */
+            Options modeOpts = opts;
+            modeOpts.hrtfInterp = (int)mode.option;
+            std::vector<double> resident, synthesisPeak;
+            for(int run=0; run<opts.nRuns; run++){
+                Run r = {};
+                if(!readRun(exePath, modeOpts, mairPath, r)){
+                    hades_renderer_destroy(&hHdR);
+                    return false;
+                }
+                resident.push_back((double)r.residentBytes);
+                synthesisPeak.push_back((double)r.profile.phases[HADES_RENDERER_INIT_PHASE_SYNTHESIS].peakMemoryIncrease);
+            }
+            if(mode.option == HADES_RENDERER_HRTF_INTERP_NEAREST)
+                nearestResident = median(resident);
+            std::printf("%-12s %26.2f %27.1f %19.2f %22.2f\n", mode.name, median(modeTimes), median(resident)/1048576.0,
+                        (median(resident) - nearestResident)/1048576.0, median(synthesisPeak)/1048576.0);
+        }
+        hades_renderer_destroy(&hHdR);
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options opts;
+
+    /* Parse arguments */
+    for(int i=1; i<argc; i++){
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if(i + 1 >= argc){
+                std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+                std::exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+        if(arg == "--mair")                opts.mairPaths.push_back(value());
+        else if(arg == "--hrir")           opts.hrirPath = value();
+        else if(arg == "--cache-dir")      opts.cacheDir = value();
+        else if(arg == "--ir-trunc")       opts.enableIRtruncation = std::atoi(value().c_str()) != 0;
+        else if(arg == "--ndirs")          opts.targetNDirs = std::atoi(value().c_str());
+        else if(arg == "--fs")             opts.sampleRate = std::atoi(value().c_str());
+        else if(arg == "--runs")           opts.nRuns = std::max(1, std::atoi(value().c_str()));
+        else if(arg == "--sweep")          opts.sweep = true;
+        else if(arg == "--latency")        opts.latency = true;
+        else if(arg == "--hrtf-interp-sweep") opts.interpSweep = true;
+        else if(arg == "--child-run")      opts.childRun = true;
+        else if(arg == "--hrtf-interp")    opts.hrtfInterp = std::atoi(value().c_str());
+        else if(arg == "-h" || arg == "--help"){
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        else {
+            std::fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if(opts.mairPaths.empty()){
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    if(opts.childRun)
+        return childRun(opts);
+
+    std::vector<ArrayResult> results;
+    for(const std::string& mairPath : opts.mairPaths){
+        ArrayResult result;
+        if(!benchmarkArray(argv[0], opts, mairPath, result))
+            return EXIT_FAILURE;
+        results.push_back(result);
+
+        /* Sweep the number of directions and the IR length (via the decimation and truncation) */
+        if(opts.sweep){
+            const int nDirsAll = opts.targetNDirs > 0 ? opts.targetNDirs : result.nDirs;
+            for(int enableIRtruncation : { 1, 0 }){
+                for(int divisor : { 1, 2, 4, 8 }){
+                    Options sweepOpts = opts;
+                    sweepOpts.enableIRtruncation = enableIRtruncation;
+                    sweepOpts.targetNDirs = divisor == 1 ? opts.targetNDirs : std::max(1, nDirsAll/divisor);
+                    if(sweepOpts.enableIRtruncation == opts.enableIRtruncation && sweepOpts.targetNDirs == opts.targetNDirs)
+                        continue; /* (already done) */
+                    ArrayResult sweepResult;
+                    if(!benchmarkArray(argv[0], sweepOpts, mairPath, sweepResult))
+                        return EXIT_FAILURE;
+                    results.push_back(sweepResult);
+                }
+            }
+        }
+    }
+
+    /* Summary */
+    if(results.size() > 1)
+        printSweepSummary(results);
+    else {
+        std::printf("\ncold: %.2f ms", results[0].runs[0].elapsed_ms);
+        if(results[0].runs.size() > 1)
+            std::printf(", warm (median): %.2f ms", warmMedian(results[0].runs, [](const Run& r){ return r.elapsed_ms; }));
+        std::printf("\ncold peak RSS increase: %.1f MiB\n", (double)results[0].runs[0].peakMemoryIncrease/1048576.0);
+    }
+
+    if(opts.latency)
+        runLatency(opts, opts.mairPaths[0]);
+    if(opts.interpSweep && !runInterpSweep(argv[0], opts, opts.mairPaths[0]))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of HADES
+ * Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+ *
+ * HADES is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+ * License.
+ */
+
+#include "process_stats.h"
+#include <cstdint>
+#include <cstdio>
+#ifdef _WIN32
+# include <windows.h>
+# include <psapi.h>
+#else
+# include <sys/resource.h>
+# include <time.h>
+# include <unistd.h>
+# ifdef __APPLE__
+#  include <mach/mach.h>
+# endif
+#endif
+
+std::size_t getPeakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    /* (the kernel32 export, so that psapi need not be linked) */
+    if(!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return (std::size_t)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage)!=0)
+        return 0;
+# ifdef __APPLE__
+    return (std::size_t)usage.ru_maxrss;       /* (bytes on macOS) */
+# else
+    return (std::size_t)usage.ru_maxrss*1024;  /* (kilobytes elsewhere) */
+# endif
+#endif
+}
+
+std::size_t getResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return (std::size_t)counters.WorkingSetSize;
+#elif defined(__APPLE__)
+    struct mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count)!=KERN_SUCCESS)
+        return 0;
+    return (std::size_t)info.resident_size;
+#else
+    std::FILE* file;
+    long pages;
+    if((file = std::fopen("/proc/self/statm", "r"))==NULL)
+        return 0;
+    if(std::fscanf(file, "%*s %ld", &pages)!=1)
+        pages = 0;
+    std::fclose(file);
+    return (std::size_t)pages*(std::size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+double getProcessCpuTime_ms()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0.0;
+    /* (in units of 100 ns) */
+    return ((double)(((std::uint64_t)kernel.dwHighDateTime<<32) | kernel.dwLowDateTime) +
+            (double)(((std::uint64_t)user.dwHighDateTime<<32) | user.dwLowDateTime))/1.0e4;
+#else
+    struct timespec ts;
+    if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts)!=0)
+        return 0.0;
+    return 1000.0*(double)ts.tv_sec + (double)ts.tv_nsec/1.0e6;
+#endif
+}
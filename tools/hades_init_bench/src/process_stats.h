@@ -0,0 +1,44 @@
+/*
+ * This file is part of HADES
+ * Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+ *
+ * HADES is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+ * License.
+ */
+
+/*
+ * Memory and CPU time of the whole benchmark process, as measured by the
+ * operating system
+ */
+
+#ifndef HADES_INIT_BENCH_PROCESS_STATS_H_INCLUDED
+#define HADES_INIT_BENCH_PROCESS_STATS_H_INCLUDED
+
+#include <cstddef>
+
+/**
+ * Returns the peak resident memory of the process so far, in bytes (the
+ * measure used by hades_renderer_getInitProfile())
+ */
+std::size_t getPeakResidentBytes();
+
+/** Returns the current resident memory of the process, in bytes */
+std::size_t getResidentBytes();
+
+/**
+ * Returns the CPU time spent by all threads of the process so far, in ms
+ * (unlike hades_renderer_getInitProfile(), this includes the work handed to
+ * worker threads)
+ */
+double getProcessCpuTime_ms();
+
+#endif /* HADES_INIT_BENCH_PROCESS_STATS_H_INCLUDED */
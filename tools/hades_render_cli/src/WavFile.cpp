@@ -0,0 +1,197 @@
+/*
+ * This file is part of HADES
+ * Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+ *
+ * HADES is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+ * License.
+ */
+
+#include "WavFile.h"
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    const uint16_t WAVE_FORMAT_PCM        = 0x0001;
+    const uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+    const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+    /* .wav files are little-endian */
+    uint16_t readU16(const unsigned char* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+    uint32_t readU32(const unsigned char* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+    void writeU16(unsigned char* p, uint16_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); }
+    void writeU32(unsigned char* p, uint32_t v) { for(int i=0; i<4; i++) p[i] = (unsigned char)(v >> (8*i)); }
+}
+
+//==============================================================================
+WavReader::~WavReader()
+{
+    if(file != nullptr)
+        fclose(file);
+}
+
+bool WavReader::open(const std::string& path, std::string& error)
+{
+    unsigned char header[12], chunk[8], fmt[40];
+    uint16_t formatTag = 0;
+    bool foundFmt = false;
+
+    file = fopen(path.c_str(), "rb");
+    if(file == nullptr){
+        error = "could not open " + path;
+        return false;
+    }
+    if(fread(header, 1, 12, file) != 12 || memcmp(header, "RIFF", 4) != 0 || memcmp(&header[8], "WAVE", 4) != 0){
+        error = path + " is not a .wav file";
+        return false;
+    }
+
+    /* Walk the chunks until the audio data is found */
+    while(fread(chunk, 1, 8, file) == 8){
+        uint32_t chunkSize = readU32(&chunk[4]);
+        if(memcmp(chunk, "fmt ", 4) == 0){
+            if(chunkSize < 16 || fread(fmt, 1, chunkSize < sizeof(fmt) ? chunkSize : sizeof(fmt), file) < 16){
+                error = path + " has a malformed format chunk";
+                return false;
+            }
+            if(chunkSize > sizeof(fmt))
+                fseek(file, (long)(chunkSize - sizeof(fmt)), SEEK_CUR);
+            formatTag     = readU16(&fmt[0]);
+            nChannels     = readU16(&fmt[2]);
+            sampleRate    = (int)readU32(&fmt[4]);
+            bitsPerSample = readU16(&fmt[14]);
+            if(formatTag == WAVE_FORMAT_EXTENSIBLE && chunkSize >= 26)
+                formatTag = readU16(&fmt[24]); /* (first two bytes of the sub-format GUID) */
+            foundFmt = true;
+        }
+        else if(memcmp(chunk, "data", 4) == 0){
+            if(!foundFmt)
+                break;
+            isFloat = formatTag == WAVE_FORMAT_IEEE_FLOAT;
+            if((formatTag != WAVE_FORMAT_PCM && formatTag != WAVE_FORMAT_IEEE_FLOAT) || nChannels < 1 ||
+               (isFloat  && bitsPerSample != 32 && bitsPerSample != 64) ||
+               (!isFloat && bitsPerSample != 16 && bitsPerSample != 24 && bitsPerSample != 32)){
+                error = path + " uses an unsupported sample format";
+                return false;
+            }
+            nFrames = nFramesLeft = (long long)chunkSize / (nChannels * (bitsPerSample/8));
+            return true;
+        }
+        else /* skip any other chunks (padded to an even size) */
+            fseek(file, (long)(chunkSize + (chunkSize & 1)), SEEK_CUR);
+    }
+    error = path + " has no audio data";
+    return false;
+}
+
+int WavReader::read(float* const* channels, int nFramesWanted)
+{
+    const int bytesPerSample = bitsPerSample/8;
+    int nRead;
+
+    if(nFramesWanted > nFramesLeft)
+        nFramesWanted = (int)nFramesLeft;
+    raw.resize((size_t)nFramesWanted * nChannels * bytesPerSample);
+    nRead = (int)(fread(raw.data(), (size_t)nChannels * bytesPerSample, (size_t)nFramesWanted, file));
+    nFramesLeft -= nRead;
+
+    /* De-interleave and convert to float */
+    const unsigned char* p = raw.data();
+    for(int i=0; i<nRead; i++){
+        for(int ch=0; ch<nChannels; ch++, p+=bytesPerSample){
+            float value;
+            if(isFloat && bytesPerSample == 4){
+                uint32_t bits = readU32(p);
+                memcpy(&value, &bits, sizeof(float));
+            }
+            else if(isFloat){
+                uint64_t bits = (uint64_t)readU32(p) | ((uint64_t)readU32(p+4) << 32);
+                double d;
+                memcpy(&d, &bits, sizeof(double));
+                value = (float)d;
+            }
+            else if(bytesPerSample == 2)
+                value = (float)(int16_t)readU16(p) / 32768.0f;
+            else if(bytesPerSample == 3)
+                value = (float)((int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) >> 8) / 8388608.0f;
+            else
+                value = (float)((double)(int32_t)readU32(p) / 2147483648.0);
+            channels[ch][i] = value;
+        }
+    }
+    return nRead;
+}
+
+//==============================================================================
+WavWriter::~WavWriter()
+{
+    close();
+}
+
+bool WavWriter::open(const std::string& path, int numChannels, int sampleRate, std::string& error)
+{
+    unsigned char header[44] = { 0 };
+
+    nChannels = numChannels;
+    nFramesWritten = 0;
+    file = fopen(path.c_str(), "wb");
+    if(file == nullptr){
+        error = "could not create " + path;
+        return false;
+    }
+
+    /* The chunk sizes are filled in by close() */
+    memcpy(&header[0], "RIFF", 4);
+    memcpy(&header[8], "WAVE", 4);
+    memcpy(&header[12], "fmt ", 4);
+    writeU32(&header[16], 16);
+    writeU16(&header[20], WAVE_FORMAT_IEEE_FLOAT);
+    writeU16(&header[22], (uint16_t)nChannels);
+    writeU32(&header[24], (uint32_t)sampleRate);
+    writeU32(&header[28], (uint32_t)(sampleRate * nChannels * 4));
+    writeU16(&header[32], (uint16_t)(nChannels * 4));
+    writeU16(&header[34], 32);
+    memcpy(&header[36], "data", 4);
+    if(fwrite(header, 1, sizeof(header), file) != sizeof(header)){
+        error = "could not write to " + path;
+        return false;
+    }
+    return true;
+}
+
+bool WavWriter::write(const float* const* channels, int nFrames)
+{
+    interleaved.resize((size_t)nFrames * nChannels);
+    for(int i=0; i<nFrames; i++)
+        for(int ch=0; ch<nChannels; ch++)
+            interleaved[(size_t)i*nChannels + ch] = channels[ch][i];
+    nFramesWritten += nFrames;
+    /* (assumes a little-endian host, as does the rest of HADES) */
+    return fwrite(interleaved.data(), sizeof(float) * nChannels, (size_t)nFrames, file) == (size_t)nFrames;
+}
+
+bool WavWriter::close()
+{
+    unsigned char size[4];
+    bool ok = true;
+
+    if(file == nullptr)
+        return true;
+    uint32_t dataSize = (uint32_t)(nFramesWritten * nChannels * 4);
+    writeU32(size, 36 + dataSize);
+    ok = ok && fseek(file, 4, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+    writeU32(size, dataSize);
+    ok = ok && fseek(file, 40, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+    ok = (fclose(file) == 0) && ok;
+    file = nullptr;
+    return ok;
+}
@@ -0,0 +1,89 @@
+/*
+ * This file is part of HADES
+ * Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+ *
+ * HADES is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+ * License.
+ */
+
+#ifndef WAVFILE_H_INCLUDED
+#define WAVFILE_H_INCLUDED
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Streams a .wav file in chunks of de-interleaved float samples
+ *
+ * Supports 16/24/32-bit integer PCM and 32/64-bit floating point data
+ * (including WAVE_FORMAT_EXTENSIBLE headers).
+ */
+class WavReader
+{
+public:
+    WavReader() = default;
+    ~WavReader();
+    WavReader(const WavReader&) = delete;
+    WavReader& operator=(const WavReader&) = delete;
+
+    /** Opens a file and parses its header; returns false (and sets 'error') on failure */
+    bool open(const std::string& path, std::string& error);
+
+    /**
+     * Reads up to 'nFrames' frames into 'channels' (getNumChannels() buffers)
+     *
+     * @returns Number of frames read (fewer than requested at the end of the file)
+     */
+    int read(float* const* channels, int nFrames);
+
+    int getNumChannels() const { return nChannels; }
+    int getSampleRate() const { return sampleRate; }
+    long long getNumFrames() const { return nFrames; }
+
+private:
+    FILE* file = nullptr;
+    int nChannels = 0;
+    int sampleRate = 0;
+    int bitsPerSample = 0;
+    bool isFloat = false;
+    long long nFrames = 0;
+    long long nFramesLeft = 0;
+    std::vector<unsigned char> raw;
+};
+
+/** Writes a 32-bit floating point .wav file from chunks of de-interleaved samples */
+class WavWriter
+{
+public:
+    WavWriter() = default;
+    ~WavWriter();
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    /** Creates a file and writes a placeholder header; returns false (and sets 'error') on failure */
+    bool open(const std::string& path, int numChannels, int sampleRate, std::string& error);
+
+    /** Appends 'nFrames' frames from 'channels' (nChannels buffers) */
+    bool write(const float* const* channels, int nFrames);
+
+    /** Fills in the final chunk sizes and closes the file */
+    bool close();
+
+private:
+    FILE* file = nullptr;
+    int nChannels = 0;
+    long long nFramesWritten = 0;
+    std::vector<float> interleaved;
+};
+
+#endif  // WAVFILE_H_INCLUDED
@@ -0,0 +1,84 @@
+/*
+ * This file is part of HADES
+ * Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+ *
+ * HADES is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+ * License.
+ */
+
+#ifndef WORKSTEALINGSCHEDULER_H_INCLUDED
+#define WORKSTEALINGSCHEDULER_H_INCLUDED
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Hands out task indices [0, nTasks) to a fixed number of workers
+ *
+ * The tasks are dealt out round-robin into one queue per worker. Each worker
+ * takes tasks from the front of its own queue, and once that is empty, steals
+ * from the back of the other workers' queues. Hence, workers that were given
+ * short tasks (e.g. short audio files) help out those that were given long
+ * ones, while rarely contending for the same queue.
+ */
+class WorkStealingScheduler
+{
+public:
+    WorkStealingScheduler(size_t nTasks, int nWorkers)
+    {
+        for(int i=0; i<nWorkers; i++)
+            queues.emplace_back(new Queue());
+        for(size_t task=0; task<nTasks; task++)
+            queues[task % queues.size()]->tasks.push_back(task);
+    }
+
+    /** Gets the next task for worker 'workerIdx'; returns false once there are none left */
+    bool next(int workerIdx, size_t& task)
+    {
+        const size_t nQueues = queues.size();
+
+        /* Own queue first */
+        {
+            Queue& own = *queues[(size_t)workerIdx];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(!own.tasks.empty()){
+                task = own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+
+        /* Then steal from the others (starting with the neighbour, to spread the stealing out) */
+        for(size_t i=1; i<nQueues; i++){
+            Queue& victim = *queues[((size_t)workerIdx + i) % nQueues];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(!victim.tasks.empty()){
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+};
+
+#endif  // WORKSTEALINGSCHEDULER_H_INCLUDED
@@ -0,0 +1,337 @@
+/*
+ * This file is part of HADES
+ * Copyright (c) 2021 - Janani Fernandez & Leo McCormack
+ *
+ * HADES is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * HADES is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * See <http://www.gnu.org/licenses/> for a copy of the GNU General Public
+ * License.
+ */
+
+/*
+ * hades_render_cli: renders microphone array recordings (.wav) to binaural
+ * offline, using ehades. A list of files may be given, which is spread over
+ * all cores, with one hades_renderer handle per worker thread.
+ */
+
+#include "ehades.h"
+#include "WavFile.h"
+#include "WorkStealingScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define NUM_EARS 2
+
+namespace
+{
+    struct Options {
+        std::string mairPath;                   /* microphone array IRs (.sofa) */
+        std::string hrirPath;                   /* HRIRs (.sofa); default HRIRs if empty */
+        std::string outDir;                     /* for list entries without an output path */
+        std::string cacheDir;                   /* on-disk IR cache; disabled if empty */
+        HADES_RENDERER_BEAMFORMER_TYPE beamOption = HADES_RENDERER_BEAMFORMER_FILTER_AND_SUM;
+        HADES_RENDERER_HRTF_INTERP_OPTIONS interpOption = HADES_RENDERER_HRTF_INTERP_NEAREST;
+        int enableCovMatching = 0;
+        int enableIRtruncation = 0;
+        int targetNDirs = 0;                    /* 0: all array IR directions */
+        float maxSteeringError = -10.0f;        /* dB */
+        int frameSize = 0;                      /* 0: library default */
+        int nJobs = 0;                          /* 0: number of cores */
+        bool compensateDelay = true;            /* true: trim the processing delay from the start of the output */
+    };
+
+    struct RenderJob {
+        std::string input;
+        std::string output;
+    };
+
+    std::mutex logMutex;
+
+    void log(const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout << message << std::endl;
+    }
+
+    void printUsage()
+    {
+        std::cout <<
+            "Usage: hades_render_cli --mair <array.sofa> [options] <input.wav> -o <output.wav>\n"
+            "       hades_render_cli --mair <array.sofa> [options] --list <files.txt> [--outdir <dir>]\n"
+            "\n"
+            "Renders microphone array recordings to binaural (32-bit float .wav).\n"
+            "Each line of a list file holds an input path, optionally followed by an output\n"
+            "path (separated by a tab); otherwise <outdir>/<input name>_binaural.wav is written.\n"
+            "\n"
+            "Options:\n"
+            "  --mair <file>        Microphone array IRs (.sofa), required\n"
+            "  --hrir <file>        HRIRs (.sofa); the built-in set is used if omitted\n"
+            "  --beamformer <type>  none | fs (filter-and-sum, default) | bmvdr\n"
+            "  --covmatch <0|1>     Spatial covariance matching (default 0)\n"
+            "  --hrtf-interp <mode> nearest (default) | triangular\n"
+            "  --ir-trunc <0|1>     Trim the near-silence from the array IRs (default 0)\n"
+            "  --ndirs <n>          Decimate the array IR grid to about <n> directions\n"
+            "  --max-steer-err <dB> Steering-vector error bound of the decimation (default -10)\n"
+            "  --framesize <n>      Processing frame size, in samples\n"
+            "  --jobs <n>           Number of files rendered in parallel (default: all cores)\n"
+            "  --cache-dir <dir>    Cache the loaded IRs in <dir>, for faster start-up next time\n"
+            "  --no-delay-comp      Keep the processing delay at the start of the output\n";
+    }
+
+    std::string defaultOutputPath(const std::string& input, const std::string& outDir)
+    {
+        size_t slash = input.find_last_of("/\\");
+        std::string name = slash == std::string::npos ? input : input.substr(slash + 1);
+        size_t dot = name.find_last_of('.');
+        if(dot != std::string::npos)
+            name = name.substr(0, dot);
+        return (outDir.empty() ? std::string(".") : outDir) + "/" + name + "_binaural.wav";
+    }
+
+    bool readList(const std::string& listPath, const std::string& outDir, std::vector<RenderJob>& jobs)
+    {
+        std::ifstream list(listPath);
+        std::string line;
+        if(!list)
+            return false;
+        while(std::getline(list, line)){
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if(line.empty() || line[0] == '#')
+                continue;
+            size_t tab = line.find('\t');
+            RenderJob job;
+            job.input = line.substr(0, tab);
+            job.output = tab == std::string::npos ? defaultOutputPath(job.input, outDir) : line.substr(tab + 1);
+            jobs.push_back(job);
+        }
+        return true;
+    }
+
+    void configure(void* hHdR, const Options& opts)
+    {
+        hades_renderer_setSofaFilePathMAIR(hHdR, opts.mairPath.c_str());
+        if(!opts.hrirPath.empty()){
+            hades_renderer_setSofaFilePathHRIR(hHdR, opts.hrirPath.c_str());
+            hades_renderer_setUseDefaultHRIRsflag(hHdR, 0);
+        }
+        hades_renderer_setCacheDirectory(hHdR, opts.cacheDir.c_str());
+        hades_renderer_setBeamformer(hHdR, opts.beamOption);
+        hades_renderer_setEnableCovMatching(hHdR, opts.enableCovMatching);
+        hades_renderer_setHRTFinterpMode(hHdR, opts.interpOption);
+        hades_renderer_setEnableIRtruncation(hHdR, opts.enableIRtruncation);
+        hades_renderer_setTargetNDirsArray(hHdR, opts.targetNDirs);
+        hades_renderer_setMaxSteeringErrorArray(hHdR, opts.maxSteeringError);
+        if(opts.frameSize > 0)
+            hades_renderer_setFrameSize(hHdR, opts.frameSize);
+    }
+
+    /* Renders one file with the given handle; returns false (and sets 'error') on failure */
+    bool renderFile(void* hHdR, const RenderJob& job, const Options& opts, std::string& error, double& durationSeconds)
+    {
+        WavReader reader;
+        WavWriter writer;
+
+        if(!reader.open(job.input, error))
+            return false;
+
+        /* (Re)initialise for this sample rate; the codec is only rebuilt if the configuration changed, and
+         * otherwise the internal buffers are just flushed */
+        hades_renderer_init(hHdR, reader.getSampleRate());
+        hades_renderer_initCodec(hHdR);
+        const int nMics = hades_renderer_getNmicsArray(hHdR);
+        if(hades_renderer_getCodecStatus(hHdR) != CODEC_STATUS_INITIALISED || nMics == 0){
+            error = "could not load " + opts.mairPath;
+            return false;
+        }
+        if(reader.getNumChannels() < nMics){
+            error = job.input + " has " + std::to_string(reader.getNumChannels()) + " channels, but the array has " +
+                    std::to_string(nMics);
+            return false;
+        }
+        if(hades_renderer_getIRsamplerateArray(hHdR) != reader.getSampleRate())
+            log("note: " + job.input + " is at " + std::to_string(reader.getSampleRate()) + " Hz, so the array IRs (at " +
+                std::to_string(hades_renderer_getIRsamplerateArray(hHdR)) + " Hz) were converted");
+        if(!writer.open(job.output, NUM_EARS, reader.getSampleRate(), error))
+            return false;
+
+        /* Frames are rendered directly from/to these buffers (zero-padded at the end of the file) */
+        const int nChannels = reader.getNumChannels();
+        const int frameSize = hades_renderer_getFrameSize(hHdR);
+        std::vector<float> inputs((size_t)nChannels * frameSize), outputs((size_t)NUM_EARS * frameSize);
+        std::vector<float*> inPtrs(nChannels);
+        float* outPtrs[NUM_EARS];
+        for(int ch=0; ch<nChannels; ch++)
+            inPtrs[ch] = &inputs[(size_t)ch * frameSize];
+        for(int ch=0; ch<NUM_EARS; ch++)
+            outPtrs[ch] = &outputs[(size_t)ch * frameSize];
+
+        /* (hades_renderer_processFrame() does not add the FIFO buffering delay) */
+        const int delay = hades_renderer_getProcessingDelay(hHdR) - frameSize;
+        long long nToSkip = opts.compensateDelay ? delay : 0;
+        const long long nToWrite = reader.getNumFrames() + (opts.compensateDelay ? 0 : delay);
+        long long nWritten = 0;
+
+        while(nWritten < nToWrite){
+            int nRead = reader.read(inPtrs.data(), frameSize);
+            for(int ch=0; ch<nChannels; ch++)
+                std::fill(inPtrs[ch] + nRead, inPtrs[ch] + frameSize, 0.0f);
+
+            hades_renderer_processFrame(hHdR, inPtrs.data(), outPtrs, nChannels, NUM_EARS, frameSize);
+
+            const int offset = (int)std::min<long long>(nToSkip, frameSize);
+            const int nOut = (int)std::min<long long>(frameSize - offset, nToWrite - nWritten);
+            const float* chunk[NUM_EARS] = { outPtrs[0] + offset, outPtrs[1] + offset };
+            nToSkip -= offset;
+            if(nOut > 0 && !writer.write(chunk, nOut)){
+                error = "could not write to " + job.output;
+                return false;
+            }
+            nWritten += nOut;
+        }
+        if(!writer.close()){
+            error = "could not write to " + job.output;
+            return false;
+        }
+        durationSeconds = (double)reader.getNumFrames() / (double)reader.getSampleRate();
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options opts;
+    std::vector<RenderJob> jobs;
+    std::string listPath, input, output;
+
+    /* Parse arguments */
+    for(int i=1; i<argc; i++){
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if(i + 1 >= argc){
+                std::cerr << "missing value for " << arg << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+        if(arg == "--mair")                opts.mairPath = value();
+        else if(arg == "--hrir")           opts.hrirPath = value();
+        else if(arg == "--list")           listPath = value();
+        else if(arg == "--outdir")         opts.outDir = value();
+        else if(arg == "--cache-dir")      opts.cacheDir = value();
+        else if(arg == "-o")               output = value();
+        else if(arg == "--covmatch")       opts.enableCovMatching = std::atoi(value().c_str()) != 0;
+        else if(arg == "--ir-trunc")       opts.enableIRtruncation = std::atoi(value().c_str()) != 0;
+        else if(arg == "--ndirs")          opts.targetNDirs = std::atoi(value().c_str());
+        else if(arg == "--max-steer-err")  opts.maxSteeringError = (float)std::atof(value().c_str());
+        else if(arg == "--framesize")      opts.frameSize = std::atoi(value().c_str());
+        else if(arg == "--jobs")           opts.nJobs = std::atoi(value().c_str());
+        else if(arg == "--no-delay-comp")  opts.compensateDelay = false;
+        else if(arg == "--beamformer"){
+            std::string type = value();
+            if(type == "none")             opts.beamOption = HADES_RENDERER_BEAMFORMER_NONE;
+            else if(type == "fs")          opts.beamOption = HADES_RENDERER_BEAMFORMER_FILTER_AND_SUM;
+            else if(type == "bmvdr")       opts.beamOption = HADES_RENDERER_BEAMFORMER_BMVDR;
+            else {
+                std::cerr << "unknown beamformer: " << type << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(arg == "--hrtf-interp"){
+            std::string mode = value();
+            if(mode == "nearest")          opts.interpOption = HADES_RENDERER_HRTF_INTERP_NEAREST;
+            else if(mode == "triangular")  opts.interpOption = HADES_RENDERER_HRTF_INTERP_TRIANGULAR;
+            else {
+                std::cerr << "unknown HRTF interpolation mode: " << mode << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(arg == "-h" || arg == "--help"){
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        else if(!arg.empty() && arg[0] != '-' && input.empty())
+            input = arg;
+        else {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if(!input.empty())
+        jobs.push_back({ input, output.empty() ? defaultOutputPath(input, opts.outDir) : output });
+    if(!listPath.empty() && !readList(listPath, opts.outDir, jobs)){
+        std::cerr << "could not read " << listPath << std::endl;
+        return EXIT_FAILURE;
+    }
+    if(opts.mairPath.empty() || jobs.empty()){
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    /* One worker (with its own renderer) per core, unless there are fewer files than that */
+    int nWorkers = opts.nJobs > 0 ? opts.nJobs : (int)std::max(1u, std::thread::hardware_concurrency());
+    nWorkers = (int)std::min<size_t>((size_t)nWorkers, jobs.size());
+    WorkStealingScheduler scheduler(jobs.size(), nWorkers);
+    std::atomic<int> nFailed(0);
+    std::atomic<long long> totalAudioMicroseconds(0);
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for(int w=0; w<nWorkers; w++){
+        workers.emplace_back([&, w]() {
+            void* hHdR = nullptr;
+            size_t task;
+
+            hades_renderer_create(&hHdR);
+            configure(hHdR, opts);
+            while(scheduler.next(w, task)){
+                std::string error;
+                double duration = 0.0;
+                const auto fileStart = std::chrono::steady_clock::now();
+                if(renderFile(hHdR, jobs[task], opts, error, duration)){
+                    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - fileStart).count();
+                    std::ostringstream msg;
+                    msg.precision(1);
+                    msg << std::fixed << jobs[task].input << " -> " << jobs[task].output << " (" << duration << " s, "
+                        << (elapsed > 0.0 ? duration/elapsed : 0.0) << "x real-time)";
+                    log(msg.str());
+                    totalAudioMicroseconds += (long long)(duration * 1e6);
+                }
+                else {
+                    log("error: " + error);
+                    nFailed++;
+                }
+            }
+            hades_renderer_destroy(&hHdR);
+        });
+    }
+    for(auto& worker : workers)
+        worker.join();
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::ostringstream summary;
+    summary.precision(1);
+    summary << std::fixed << "Rendered " << (jobs.size() - (size_t)nFailed) << "/" << jobs.size() << " files with "
+            << nWorkers << " worker(s) in " << elapsed << " s (" << (elapsed > 0.0 ? (double)totalAudioMicroseconds/1e6/elapsed : 0.0)
+            << "x real-time overall)";
+    log(summary.str());
+    return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}